@@ -0,0 +1,25 @@
+#ifndef LAB3_BENCH_HPP
+#define LAB3_BENCH_HPP
+
+#include "../elf.hpp"
+
+#include <chrono>
+
+// Header of the last section called `name`, or an all-zero header if there is none.
+inline ELF32_Section_Header find_section(const ELF_Image &image, const char *name) {
+    const ELF32_File_Header &file_header = *image.view<ELF32_File_Header>(0);
+    const ELF32_Section_Header &shstrtab_header = *image.view<ELF32_Section_Header>(file_header.e_shoff + (uint64_t)file_header.e_shstrndx * file_header.e_shentsize);
+    const char *shstrtab = image.view<char>(shstrtab_header.sh_offset, shstrtab_header.sh_size);
+    ELF32_Section_Header result{};
+    for (size_t i = 0; i < file_header.e_shnum; i++) {
+        const ELF32_Section_Header &section_header = *image.view<ELF32_Section_Header>(file_header.e_shoff + i * file_header.e_shentsize);
+        if (section_header.sh_name < shstrtab_header.sh_size && strcmp(shstrtab + section_header.sh_name, name) == 0) result = section_header;
+    }
+    return result;
+}
+
+inline double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+#endif //LAB3_BENCH_HPP
@@ -0,0 +1,86 @@
+#include "bench.hpp"
+#include "synthetic_elf.hpp"
+#include "../cfg.hpp"
+#include "../disasm.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include <sys/resource.h>
+
+static double peak_rss_mb() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss / 1024.0;
+}
+
+// Builds the control-flow graph of synthetic files of --size bytes of .text, then a quarter and a sixteenth of that,
+// to show that the build time per instruction does not grow with the file; or of the ELF files given. For each: the
+// best of --repeat builds, the size of the graph, the growth of the peak RSS over the build (scratch space included)
+// and the time to write it as DOT and as binary. Exits with 2 if some predecessor list does not mirror the successors.
+int main(int argc, char *argv[]) {
+    std::vector<const char *> paths;
+    size_t size = 64 << 20, repeat = 3;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) size = std::stoull(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = std::stoul(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1ul, std::stoul(argv[++i]));
+        else paths.push_back(argv[i]);
+    }
+
+    int result = 0;
+    try {
+        std::vector<size_t> sizes = {size / 16, size / 4, size};
+        for (size_t n = 0; n < (paths.empty() ? sizes.size() : paths.size()); n++) {
+            std::vector<uint8_t> file;
+            Disassembler disassembler;
+            if (paths.empty()) {
+                file = Synthetic_ELF(seed).generate(sizes[n]);
+                disassembler.open(file.data(), file.size());
+            } else {
+                disassembler.open(paths[n]);
+            }
+
+            Flow_Graph graph;
+            double rss_before = peak_rss_mb(), build = 1e9;
+            for (size_t r = 0; r < repeat; r++) {
+                auto start = std::chrono::steady_clock::now();
+                disassembler.flow_graph(graph);
+                build = std::min(build, seconds_since(start));
+            }
+            double rss_growth = peak_rss_mb() - rss_before;
+
+            Flow_Graph::Tables tables = graph.tables();
+            size_t insns = 0;
+            for (size_t b = 0; b < tables.blocks_count; b++) insns += tables.blocks[b].insns_count;
+            for (uint32_t b = 0; b < tables.blocks_count; b++) {
+                for (uint32_t to : graph.successors_of(b)) {
+                    Flow_Graph::Range from = graph.predecessors_of(to);
+                    if (std::find(from.begin(), from.end(), b) == from.end()) result = 2;
+                }
+            }
+            if (tables.predecessor_offsets[tables.blocks_count] != tables.edges_count) result = 2;
+
+            Output_Buffer dot(nullptr), binary(nullptr);
+            auto start = std::chrono::steady_clock::now();
+            disassembler.print_flow_graph(graph, dot, GRAPH_DOT);
+            double write_dot = seconds_since(start);
+            start = std::chrono::steady_clock::now();
+            disassembler.print_flow_graph(graph, binary, GRAPH_BINARY);
+            double write_binary = seconds_since(start);
+
+            printf("%s: %u bytes of .text, %zu functions, %zu blocks, %zu edges, %zu instructions in blocks\n", paths.empty() ? "synthetic" : paths[n], disassembler.text_size(),
+                   tables.functions_count, tables.blocks_count, tables.edges_count, insns);
+            printf("  build %8.3f ms (%.1f ns/insn), graph %.1f MB (%.1f bytes/block), peak RSS +%.1f MB\n", build * 1e3, build * 1e9 / std::max<size_t>(1, insns),
+                   graph.memory_size() / 1e6, (double)graph.memory_size() / std::max<size_t>(1, tables.blocks_count), rss_growth);
+            printf("  dot %.1f MB in %.3f ms, binary %.1f MB in %.3f ms\n", dot.view().size() / 1e6, write_dot * 1e3, binary.view().size() / 1e6, write_binary * 1e3);
+        }
+        if (result != 0) std::cerr << "predecessors do not match successors\n";
+    } catch (std::exception &e) {
+        std::cerr << e.what() << '\n';
+        result = 1;
+    }
+    return result;
+}
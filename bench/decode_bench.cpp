@@ -0,0 +1,133 @@
+#include "bench.hpp"
+#include "../decode.hpp"
+#include "../elf.hpp"
+#include "../format.hpp"
+#include "../labels.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <new>
+
+// Every heap allocation in the process is counted, so the formatting loop can check that it does none.
+std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size) {
+    allocations++;
+    if (void *ptr = malloc(size == 0 ? 1 : size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+// Builds the label index for the file and times lookups of every instruction address and target,
+// next to the std::map<uint32_t, std::string> that disasm() used to fill with operator[].
+void bench_labels(const ELF_Image &image, const std::vector<DecodedInsn> &insns, Label_Index &labels) {
+    ELF32_Section_Header text_header = find_section(image, ".text"), symtab_header = find_section(image, ".symtab"), strtab_header = find_section(image, ".strtab");
+    size_t symbols_count = symtab_header.sh_size / sizeof(ELF32_Symbol);
+    const ELF32_Symbol *symbols = image.view<ELF32_Symbol>(symtab_header.sh_offset, symbols_count);
+    const uint8_t *strtab = image.view<uint8_t>(strtab_header.sh_offset, strtab_header.sh_size);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<uint32_t> targets;
+    for (const DecodedInsn &insn : insns) {
+        if (insn.has_target) targets.push_back(insn.target);
+    }
+    labels.build(symbols, symbols_count, strtab, strtab_header.sh_size, targets, text_header.sh_addr, text_header.sh_size);
+    double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t found = 0;
+    start = std::chrono::steady_clock::now();
+    for (const DecodedInsn &insn : insns) {
+        found += labels.find(insn.address).size();
+        if (insn.has_target) found += labels.find(insn.target).size();
+    }
+    double lookup_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("label index:     %zu labels, %zu bytes, built in %.3f ms, %.1f ns/lookup\n", labels.size(), labels.memory_usage(), build_seconds * 1e3, lookup_seconds * 1e9 / (insns.size() + targets.size()));
+
+    std::map<uint32_t, std::string> marks;
+    start = std::chrono::steady_clock::now();
+    for (const DecodedInsn &insn : insns) {
+        found += marks[insn.address].size();
+        if (insn.has_target) found += marks[insn.target].size();
+    }
+    lookup_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t node_bytes = sizeof(std::pair<const uint32_t, std::string>) + 4 * sizeof(void *);
+    printf("std::map:        %zu nodes, ~%zu bytes, %.1f ns/lookup (%zu)\n", marks.size(), marks.size() * node_bytes, lookup_seconds * 1e9 / (insns.size() + targets.size()), found);
+}
+
+// Times decode_range() alone, decode + print_insn() and decode + print_insn_json() over the .text of an ELF file,
+// repeated until `instructions` instructions are processed. Exits with 2 if decoding and formatting allocated memory.
+int main(int argc, char *argv[]) {
+    const char *path = (argc > 1 ? argv[1] : "input.elf");
+    size_t instructions = (argc > 2 ? std::stoull(argv[2]) : 10000000);
+    try {
+        ELF_Image image(path);
+        ELF32_Section_Header text_header = find_section(image, ".text");
+        const uint8_t *text = image.view<uint8_t>(text_header.sh_offset, text_header.sh_size);
+        if (text_header.sh_size < 4) throw FileFormatException("No .text section!");
+
+        std::vector<DecodedInsn> insns;
+        size_t done = 0, compressed = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (done < instructions) {
+            insns.clear();
+            decode_range(text, text_header.sh_size, text_header.sh_addr, insns);
+            done += insns.size();
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        for (const DecodedInsn &insn : insns) compressed += (insn.length == 2);
+        printf("decode:          %zu instructions in %.3f s: %.1f ns/insn, %.2f M insn/s (%.1f%% compressed)\n", done, seconds, seconds * 1e9 / done, done / seconds / 1e6, 100.0 * compressed / insns.size());
+        Label_Index labels;
+        bench_labels(image, insns, labels);
+
+        FILE *null_file = fopen("/dev/null", "w");
+        Output_Buffer output(null_file);
+        size_t bytes = 0, allocations_before = allocations;
+        done = 0;
+        start = std::chrono::steady_clock::now();
+        while (done < instructions) {
+            for (size_t cur = 0; cur + 4 <= text_header.sh_size && done < instructions; done++) {
+                DecodedInsn insn = decode_insn(text + cur, text_header.sh_addr + cur);
+                print_insn(insn, labels.find(insn.address), (insn.has_target ? labels.find(insn.target) : std::string_view()), output);
+                bytes += output.view().size();
+                output.clear();
+                cur += insn.length;
+            }
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        size_t format_allocations = allocations - allocations_before;
+        printf("decode + format: %zu instructions in %.3f s: %.1f ns/insn, %.2f M insn/s, %.1f MB/s of text\n", done, seconds, seconds * 1e9 / done, done / seconds / 1e6, bytes / seconds / 1e6);
+
+        // The same with JSON Lines, which escapes every label it writes.
+        bytes = 0;
+        allocations_before = allocations;
+        done = 0;
+        start = std::chrono::steady_clock::now();
+        while (done < instructions) {
+            for (size_t cur = 0; cur + 4 <= text_header.sh_size && done < instructions; done++) {
+                DecodedInsn insn = decode_insn(text + cur, text_header.sh_addr + cur);
+                print_insn_json(insn, labels.find(insn.address), (insn.has_target ? labels.find(insn.target) : std::string_view()), output);
+                bytes += output.view().size();
+                output.clear();
+                cur += insn.length;
+            }
+        }
+        double json_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        format_allocations += allocations - allocations_before;
+        fclose(null_file);
+        printf("decode + jsonl:  %zu instructions in %.3f s: %.1f ns/insn, %.2f M insn/s, %.1f MB/s of JSON, %.2fx the text time\n", done, json_seconds, json_seconds * 1e9 / done, done / json_seconds / 1e6, bytes / json_seconds / 1e6, json_seconds / seconds);
+        printf("heap allocations while decoding and formatting: %zu\n", format_allocations);
+        if (format_allocations != 0) return 2;
+    } catch (std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "bench.hpp"
+#include "synthetic_elf.hpp"
+#include "../columnar.hpp"
+#include "../disasm.hpp"
+#include "../format.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Compares the output formats: the time to write each of text, jsonl and columnar (best of --repeat runs of disasm()
+// into memory) and its size. For text and columnar also the time a consumer that needs the address and mnemonic of
+// every instruction takes to read them back into a mnemonic histogram (parsing "%08x %10s: mnemonic ..." lines
+// against indexing the mnemonic column). The columnar file is also turned back into listing lines with print_insn(), which
+// must give the .text part of the text listing exactly; exits with 2 if it does not.
+// Without an ELF argument a synthetic file of --size bytes of .text is used.
+int main(int argc, char *argv[]) {
+    const char *path = nullptr;
+    size_t size = 16 << 20, repeat = 5;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) size = std::stoull(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = std::stoul(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1ul, std::stoul(argv[++i]));
+        else path = argv[i];
+    }
+
+    int result = 0;
+    try {
+        std::vector<uint8_t> file;
+        ELF_Image image;
+        if (path == nullptr) {
+            file = Synthetic_ELF(seed).generate(size);
+            image.assign(file.data(), file.size());
+        } else {
+            image.load(path);
+        }
+
+        Disasm_Options text_options, json_options, columnar_options;
+        json_options.format = FORMAT_JSONL;
+        columnar_options.format = FORMAT_COLUMNAR;
+        Disasm_Context text_context, json_context, columnar_context;
+        double write_text = 1e9, write_json = 1e9, write_columnar = 1e9, read_text = 1e9, read_columnar = 1e9;
+        std::vector<size_t> text_histogram(MN_COUNT), columnar_histogram(MN_COUNT);
+        for (size_t r = 0; r < repeat; r++) {
+            text_context.output.clear();
+            json_context.output.clear();
+            columnar_context.output.clear();
+            auto start = std::chrono::steady_clock::now();
+            disasm(image, nullptr, text_options, text_context);
+            write_text = std::min(write_text, seconds_since(start));
+            start = std::chrono::steady_clock::now();
+            disasm(image, nullptr, json_options, json_context);
+            write_json = std::min(write_json, seconds_since(start));
+            start = std::chrono::steady_clock::now();
+            disasm(image, nullptr, columnar_options, columnar_context);
+            write_columnar = std::min(write_columnar, seconds_since(start));
+
+            // What the analytics jobs do with the listing: split lines, parse the address, look the mnemonic up.
+            std::string_view text = text_context.output.view();
+            std::fill(text_histogram.begin(), text_histogram.end(), 0);
+            start = std::chrono::steady_clock::now();
+            size_t end = text.find("\n.symtab");
+            for (size_t line = text.find('\n') + 1, next; line < end; line = next + 1) {
+                next = text.find('\n', line);
+                char *rest;
+                strtoul(text.data() + line, &rest, 16);
+                size_t colon = text.find(": ", line + 9);
+                std::string_view mnemonic = text.substr(colon + 2, next - colon - 2);
+                mnemonic = mnemonic.substr(0, mnemonic.find(' '));
+                size_t id = std::find(mnemonic_names, mnemonic_names + MN_COUNT, mnemonic) - mnemonic_names;
+                text_histogram[id == MN_COUNT ? 0 : id] += (rest == text.data() + line + 8);
+            }
+            read_text = std::min(read_text, seconds_since(start));
+
+            std::string_view columnar = columnar_context.output.view();
+            std::fill(columnar_histogram.begin(), columnar_histogram.end(), 0);
+            start = std::chrono::steady_clock::now();
+            Columnar_File reader;
+            reader.attach(reinterpret_cast<const uint8_t *>(columnar.data()), columnar.size());
+            for (size_t i = 0; i < reader.size(); i++) columnar_histogram[reader.mnemonic[i]]++;
+            read_columnar = std::min(read_columnar, seconds_since(start));
+        }
+
+        std::string_view text = text_context.output.view(), columnar = columnar_context.output.view();
+        Columnar_File reader;
+        reader.attach(reinterpret_cast<const uint8_t *>(columnar.data()), columnar.size());
+        Output_Buffer rebuilt(nullptr);
+        rebuilt.write(".text\n");
+        const Columnar_Label *labels_end = reader.labels + reader.info().labels_count;
+        for (size_t i = 0; i < reader.size(); i++) {
+            uint32_t target_label = reader.target_label[i];
+            DecodedInsn insn{reader.address[i], target_label != columnar_no_label ? reader.labels[target_label].address : 0, reader.imm[i], reader.mnemonic[i],
+                             reader.operands[i], reader.rd[i], reader.rs1[i], reader.rs2[i], reader.length[i], target_label != columnar_no_label};
+            const Columnar_Label *label = std::lower_bound(reader.labels, labels_end, insn.address, [](const Columnar_Label &entry, uint32_t address) {
+                return entry.address < address;
+            });
+            std::string_view mark = (label != labels_end && label->address == insn.address ? reader.string(label->name) : std::string_view());
+            print_insn(insn, mark, reader.label_name(target_label), rebuilt);
+        }
+        if (text.substr(0, text.find("\n.symtab")) != rebuilt.view() || text_histogram != columnar_histogram) {
+            std::cerr << "columnar output differs from the listing\n";
+            result = 2;
+        }
+
+        size_t insns = reader.size();
+        printf("%s: %zu instructions, %zu labels, best of %zu\n", path == nullptr ? "synthetic" : path, insns, (size_t)reader.info().labels_count, repeat);
+        printf("text:     %9.1f MB, written in %8.3f ms, read in %8.3f ms (%.1f ns/insn)\n", text.size() / 1e6, write_text * 1e3, read_text * 1e3, read_text * 1e9 / insns);
+        printf("jsonl:    %9.1f MB, written in %8.3f ms, %.2fx the text time\n", json_context.output.view().size() / 1e6, write_json * 1e3, write_json / write_text);
+        printf("columnar: %9.1f MB, written in %8.3f ms, read in %8.3f ms (%.1f ns/insn)\n", columnar.size() / 1e6, write_columnar * 1e3, read_columnar * 1e3, read_columnar * 1e9 / insns);
+    } catch (std::exception &e) {
+        std::cerr << e.what() << '\n';
+        result = 1;
+    }
+    return result;
+}
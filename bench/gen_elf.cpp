@@ -0,0 +1,23 @@
+#include "synthetic_elf.hpp"
+
+#include <iostream>
+
+// gen_elf <text size in bytes> <seed> <output file> [percent of compressed instructions] [32 or 64: ELF class]
+//         [number of code sections] [percent of A, F, D, Zicsr and B instructions]
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        std::cerr << "Usage: gen_elf SIZE SEED OUTPUT [COMPRESSED_PERCENT] [XLEN] [SECTIONS] [EXTENSION_PERCENT]\n";
+        return 1;
+    }
+    Synthetic_ELF generator(std::stoul(argv[2]), argc > 4 ? std::stoul(argv[4]) : 50, argc > 7 ? std::stoul(argv[7]) : 0);
+    bool rv64 = (argc > 5 && std::stoul(argv[5]) == 64);
+    size_t sections = (argc > 6 ? std::stoul(argv[6]) : 1);
+    std::vector<uint8_t> file = (rv64 ? generator.generate64(std::stoull(argv[1]), sections) : generator.generate(std::stoull(argv[1]), sections));
+    FILE *output = fopen(argv[3], "wb");
+    if (output == nullptr || fwrite(file.data(), 1, file.size(), output) != file.size()) {
+        std::cerr << "Unable to write output file!\n";
+        return 1;
+    }
+    fclose(output);
+    return 0;
+}
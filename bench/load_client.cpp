@@ -0,0 +1,138 @@
+#include "bench.hpp"
+#include "../parallel.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// One client connection to the server started with --serve, sending a request line and reading the whole reply.
+class Connection {
+private:
+    int fd;
+    std::string pending;
+
+public:
+    explicit Connection(const char *socket_path) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, socket_path, sizeof address.sun_path - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0) throw FileNotFoundException("Unable to connect to the server!");
+    }
+
+    Connection(const Connection &) = delete;
+    Connection &operator=(const Connection &) = delete;
+
+    ~Connection() {
+        close(fd);
+    }
+
+    // Sends `request` and returns the reply text; false if it was an ERR reply.
+    bool request(const std::string &request, std::string &reply) {
+        if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size()) throw FileFormatException("Connection closed!");
+        size_t newline;
+        while ((newline = pending.find('\n')) == std::string::npos) receive();
+        std::string header = pending.substr(0, newline);
+        pending.erase(0, newline + 1);
+        if (header.compare(0, 3, "OK ") != 0) {
+            reply = header;
+            return false;
+        }
+        size_t length = std::stoull(header.substr(3));
+        while (pending.size() < length) receive();
+        reply.assign(pending, 0, length);
+        pending.erase(0, length);
+        return true;
+    }
+
+private:
+    void receive() {
+        char buffer[1 << 16];
+        ssize_t got = recv(fd, buffer, sizeof buffer, 0);
+        if (got <= 0) throw FileFormatException("Connection closed!");
+        pending.append(buffer, got);
+    }
+};
+
+// Load generator for --serve: --clients connections each send --requests requests about one ELF file, one at a time,
+// at random addresses of its .text (pc with --context bytes, lookup and range in the ratio 6:3:1), and the latency of
+// every request is recorded. The first request, which parses the file, is made and reported separately.
+int main(int argc, char *argv[]) {
+    const char *socket_path = nullptr, *path = nullptr;
+    size_t clients = 8, requests = 10000;
+    uint32_t context = 32, seed = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--clients" && i + 1 < argc) clients = std::max(1ul, std::stoul(argv[++i]));
+        else if (arg == "--requests" && i + 1 < argc) requests = std::max(1ul, std::stoul(argv[++i]));
+        else if (arg == "--context" && i + 1 < argc) context = std::stoul(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = std::stoul(argv[++i]);
+        else if (socket_path == nullptr) socket_path = argv[i];
+        else path = argv[i];
+    }
+    if (socket_path == nullptr || path == nullptr) {
+        std::cerr << "usage: load_client [--clients N] [--requests N] [--context BYTES] [--seed N] SOCKET FILE\n";
+        return 1;
+    }
+    char real_path[PATH_MAX];
+    if (realpath(path, real_path) != nullptr) path = real_path;
+
+    try {
+        std::string reply;
+        auto start = std::chrono::steady_clock::now();
+        Connection first(socket_path);
+        if (!first.request(std::string("info ") + path + "\n", reply)) throw FileFormatException(reply);
+        double first_seconds = seconds_since(start);
+        uint32_t text_address = std::stoul(reply.substr(5), nullptr, 16), text_size = std::stoul(reply.substr(reply.find(' ', 5)));
+        if (text_size == 0) throw FileFormatException("No .text section!");
+
+        std::vector<std::vector<double>> latencies(clients);
+        std::vector<size_t> errors(clients), bytes(clients);
+        start = std::chrono::steady_clock::now();
+        run_parallel(clients, [&](size_t c) {
+            Connection connection(socket_path);
+            std::mt19937 random(seed + c);
+            std::string request, reply;
+            latencies[c].reserve(requests);
+            for (size_t r = 0; r < requests; r++) {
+                uint32_t address = text_address + random() % text_size, kind = random() % 10;
+                char line[64];
+                if (kind < 6) snprintf(line, sizeof line, "pc 0x%x %u ", address, context);
+                else if (kind < 9) snprintf(line, sizeof line, "lookup 0x%x ", address);
+                else snprintf(line, sizeof line, "range 0x%x 0x%x ", address, address + 4 * context);
+                request.assign(line).append(path).push_back('\n');
+                auto sent = std::chrono::steady_clock::now();
+                errors[c] += !connection.request(request, reply);
+                latencies[c].push_back(seconds_since(sent));
+                bytes[c] += reply.size();
+            }
+        });
+        double seconds = seconds_since(start);
+
+        std::vector<double> all;
+        size_t error_count = 0, byte_count = 0;
+        for (size_t c = 0; c < clients; c++) {
+            all.insert(all.end(), latencies[c].begin(), latencies[c].end());
+            error_count += errors[c];
+            byte_count += bytes[c];
+        }
+        std::sort(all.begin(), all.end());
+        auto percentile = [&all](double p) {
+            return all[std::min(all.size() - 1, (size_t)(p * all.size()))] * 1e6;
+        };
+        printf("%s: %zu clients x %zu requests in %.3f s, %.0f requests/s, %.1f MB of replies, %zu ERR replies\n", path, clients, requests, seconds, all.size() / seconds, byte_count / 1e6, error_count);
+        printf("first request (parse): %.1f us\n", first_seconds * 1e6);
+        printf("latency: p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n", percentile(0.5), percentile(0.9), percentile(0.99), all.back() * 1e6);
+    } catch (std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
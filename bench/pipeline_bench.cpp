@@ -0,0 +1,123 @@
+#include "bench.hpp"
+#include "synthetic_elf.hpp"
+#include "../decode.hpp"
+#include "../elf.hpp"
+#include "../format.hpp"
+#include "../labels.hpp"
+#include "../output.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include <unistd.h>
+
+// Best time of every stage of the .text listing over all repetitions.
+struct Stage_Times {
+    double parse = 1e9, labels = 1e9, decode = 1e9, format = 1e9, write = 1e9;
+};
+
+void report(const char *stage, double seconds, size_t insns, size_t bytes, const char *unit) {
+    printf("%-8s %9.3f ms %9.2f M insn/s %9.1f MB/s of %s\n", stage, seconds * 1e3, insns / seconds / 1e6, bytes / seconds / 1e6, unit);
+}
+
+// Runs the stages of disasm() on one file separately:
+//   parse  - open and map the file, find .text, .symtab and .strtab;
+//   labels - decode .text for jump and branch targets and build the label index;
+//   decode - decode .text into DecodedInsn records;
+//   format - print the records into an in-memory Output_Buffer;
+//   write  - write the listing to a temporary file.
+// Without an ELF argument a synthetic RV32IMC file of --size bytes of .text is generated first, with --extensions
+// percent of its instructions from A, F, D, Zicsr and B. Decoding checks the extensions the file selects, as disasm() does.
+int main(int argc, char *argv[]) {
+    const char *path = nullptr;
+    size_t size = 16 << 20, repeat = 5;
+    uint32_t seed = 1, extension_percent = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) size = std::stoull(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = std::stoul(argv[++i]);
+        else if (arg == "--extensions" && i + 1 < argc) extension_percent = std::stoul(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1ul, std::stoul(argv[++i]));
+        else path = argv[i];
+    }
+
+    char synthetic_path[] = "/tmp/lab3_bench_XXXXXX";
+    try {
+        if (path == nullptr) {
+            std::vector<uint8_t> file = Synthetic_ELF(seed, 50, extension_percent).generate(size);
+            int fd = mkstemp(synthetic_path);
+            if (fd < 0 || write(fd, file.data(), file.size()) != (ssize_t)file.size()) throw FileNotFoundException("Unable to write synthetic ELF!");
+            close(fd);
+            path = synthetic_path;
+        }
+
+        Stage_Times best;
+        size_t text_size = 0, insns_count = 0, listing_size = 0;
+        std::vector<uint32_t> targets;
+        std::vector<DecodedInsn> insns;
+        Label_Index labels;
+        Output_Buffer output(nullptr);
+        for (size_t r = 0; r < repeat; r++) {
+            auto start = std::chrono::steady_clock::now();
+            ELF_Image image(path);
+            ELF32_Section_Header text_header = find_section(image, ".text"), symtab_header = find_section(image, ".symtab"), strtab_header = find_section(image, ".strtab");
+            const uint8_t *text = image.view<uint8_t>(text_header.sh_offset, text_header.sh_size);
+            size_t symbols_count = symtab_header.sh_size / sizeof(ELF32_Symbol);
+            const ELF32_Symbol *symbols = image.view<ELF32_Symbol>(symtab_header.sh_offset, symbols_count);
+            const uint8_t *strtab = image.view<uint8_t>(strtab_header.sh_offset, strtab_header.sh_size);
+            ELF32_Section_Header attributes_header = find_section(image, ".riscv.attributes");
+            std::string_view arch = find_riscv_arch(image.view<uint8_t>(attributes_header.sh_offset, attributes_header.sh_size), attributes_header.sh_size);
+            uint32_t extensions = select_extensions(image.view<ELF32_File_Header>(0)->e_flags, arch);
+            best.parse = std::min(best.parse, seconds_since(start));
+            text_size = text_header.sh_size;
+
+            start = std::chrono::steady_clock::now();
+            targets.clear();
+            for (size_t cur = 0; cur < text_size;) {
+                check_insn(text, cur, text_size);
+                DecodedInsn insn = decode_insn(text + cur, text_header.sh_addr + cur, extensions);
+                if (insn.has_target) targets.push_back(insn.target);
+                cur += insn.length;
+            }
+            labels.build(symbols, symbols_count, strtab, strtab_header.sh_size, targets, text_header.sh_addr, text_size);
+            best.labels = std::min(best.labels, seconds_since(start));
+
+            start = std::chrono::steady_clock::now();
+            insns.clear();
+            decode_range(text, text_size, text_header.sh_addr, insns, extensions);
+            best.decode = std::min(best.decode, seconds_since(start));
+            insns_count = insns.size();
+
+            start = std::chrono::steady_clock::now();
+            output.clear();
+            for (const DecodedInsn &insn : insns) {
+                print_insn(insn, labels.find(insn.address), (insn.has_target ? labels.find(insn.target) : std::string_view()), output);
+            }
+            best.format = std::min(best.format, seconds_since(start));
+            listing_size = output.view().size();
+
+            start = std::chrono::steady_clock::now();
+            FILE *listing = tmpfile();
+            if (listing == nullptr) throw FileNotFoundException("Unable to open output file!");
+            fwrite(output.view().data(), 1, listing_size, listing);
+            fclose(listing);
+            best.write = std::min(best.write, seconds_since(start));
+        }
+
+        size_t compressed = std::count_if(insns.begin(), insns.end(), [](const DecodedInsn &insn) { return insn.length == 2; });
+        printf("%s: %zu bytes of .text, %zu instructions (%.1f%% compressed), %zu labels, %zu bytes of listing, best of %zu\n",
+               path == synthetic_path ? "synthetic" : path, text_size, insns_count, 100.0 * compressed / std::max<size_t>(1, insns_count), labels.size(), listing_size, repeat);
+        report("parse", best.parse, insns_count, text_size, ".text");
+        report("labels", best.labels, insns_count, text_size, ".text");
+        report("decode", best.decode, insns_count, text_size, ".text");
+        report("format", best.format, insns_count, listing_size, "listing");
+        report("write", best.write, insns_count, listing_size, "listing");
+        report("total", best.parse + best.labels + best.decode + best.format + best.write, insns_count, text_size, ".text");
+    } catch (std::exception &e) {
+        std::cerr << e.what() << '\n';
+        if (path == synthetic_path) unlink(synthetic_path);
+        return 1;
+    }
+    if (path == synthetic_path) unlink(synthetic_path);
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "bench.hpp"
+#include "synthetic_elf.hpp"
+#include "../decode.hpp"
+#include "../elf.hpp"
+#include "../parallel.hpp"
+#include "../prescan.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+#include <unistd.h>
+
+// Compares the scalar walk over .text with the pre-scan, for each kernel the CPU has: finding the instruction
+// boundaries alone (as chunk splitting does) and collecting jump and branch targets (the label pass), best of
+// --repeat runs each. Exits with 2 if a kernel finds other boundaries or targets than the scalar walk.
+// Without an ELF argument a synthetic file of --size bytes is used.
+int main(int argc, char *argv[]) {
+    const char *path = nullptr;
+    size_t size = 16 << 20, repeat = 5;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) size = std::stoull(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc) seed = std::stoul(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1ul, std::stoul(argv[++i]));
+        else path = argv[i];
+    }
+
+    char synthetic_path[] = "/tmp/lab3_bench_XXXXXX";
+    int result = 0;
+    try {
+        if (path == nullptr) {
+            std::vector<uint8_t> file = Synthetic_ELF(seed).generate(size);
+            int fd = mkstemp(synthetic_path);
+            if (fd < 0 || write(fd, file.data(), file.size()) != (ssize_t)file.size()) throw FileNotFoundException("Unable to write synthetic ELF!");
+            close(fd);
+            path = synthetic_path;
+        }
+        ELF_Image image(path);
+        ELF32_Section_Header text_header = find_section(image, ".text");
+        const uint8_t *text = image.view<uint8_t>(text_header.sh_offset, text_header.sh_size);
+        size_t text_size = text_header.sh_size & ~(size_t)1;
+        uint32_t address = text_header.sh_addr;
+
+        struct Variant {
+            const char *name;
+            Prescan_Kernel kernel;
+        };
+        std::vector<Variant> variants = {{"scalar", prescan_scalar}};
+#ifdef LAB3_PRESCAN_X86
+        if (__builtin_cpu_supports("sse2")) variants.push_back({"sse2", prescan_sse2});
+        if (__builtin_cpu_supports("avx2")) variants.push_back({"avx2", prescan_avx2});
+#endif
+
+        auto walk_boundaries = [&]() {
+            size_t cur = 0, count = 0;
+            for (; cur < text_size; count++) cur = next_boundary(text, cur);
+            return std::make_pair(cur, count);
+        };
+        auto walk_targets = [&](std::vector<uint32_t> &targets) {
+            size_t cur = 0;
+            while (cur < text_size) {
+                check_insn(text, cur, text_size);
+                DecodedInsn insn = decode_insn(text + cur, address + cur);
+                if (insn.has_target) targets.push_back(insn.target);
+                cur += insn.length;
+            }
+            return cur;
+        };
+        auto scan_targets = [&](std::vector<uint32_t> &targets, Prescan_Kernel kernel) {
+            return scan_starts(text, 0, text_size, [&](size_t offset) {
+                check_insn(text, offset, text_size);
+                DecodedInsn insn = decode_insn(text + offset, address + offset);
+                if (insn.has_target) targets.push_back(insn.target);
+            }, kernel);
+        };
+
+        std::pair<size_t, size_t> boundaries = walk_boundaries();
+        size_t insns_count = boundaries.second;
+        std::vector<uint32_t> expected, targets;
+        walk_targets(expected);
+        for (const Variant &variant : variants) {
+            targets.clear();
+            size_t end = scan_targets(targets, variant.kernel);
+            if (end != boundaries.first || targets != expected || scan_starts(text, 0, text_size, [](size_t) {}, variant.kernel) != boundaries.first) {
+                std::cerr << variant.name << " pre-scan differs from the scalar walk\n";
+                result = 2;
+            }
+        }
+
+        double walk = 1e9, labels = 1e9;
+        std::vector<double> skip(variants.size(), 1e9), scan_labels(variants.size(), 1e9);
+        size_t checksum = 0;
+        for (size_t r = 0; r < repeat; r++) {
+            auto start = std::chrono::steady_clock::now();
+            checksum += walk_boundaries().first;
+            walk = std::min(walk, seconds_since(start));
+
+            targets.clear();
+            start = std::chrono::steady_clock::now();
+            checksum += walk_targets(targets);
+            labels = std::min(labels, seconds_since(start));
+
+            for (size_t v = 0; v < variants.size(); v++) {
+                start = std::chrono::steady_clock::now();
+                checksum += scan_starts(text, 0, text_size, [](size_t) {}, variants[v].kernel);
+                skip[v] = std::min(skip[v], seconds_since(start));
+
+                targets.clear();
+                start = std::chrono::steady_clock::now();
+                checksum += scan_targets(targets, variants[v].kernel);
+                scan_labels[v] = std::min(scan_labels[v], seconds_since(start));
+            }
+        }
+
+        printf("%s: %zu instructions, %zu targets, best of %zu (%zu)\n", path == synthetic_path ? "synthetic" : path, insns_count, expected.size(), repeat, checksum % 10);
+        printf("boundaries, scalar walk: %8.3f ms, %.2f ns/insn, %.2f GB/s\n", walk * 1e3, walk * 1e9 / insns_count, text_size / walk / 1e9);
+        for (size_t v = 0; v < variants.size(); v++) {
+            printf("boundaries, %-6s scan:  %8.3f ms, %.2f ns/insn, %.2f GB/s, speedup %.2fx\n", variants[v].name, skip[v] * 1e3, skip[v] * 1e9 / insns_count, text_size / skip[v] / 1e9, walk / skip[v]);
+        }
+        printf("labels, scalar walk:     %8.3f ms, %.2f ns/insn\n", labels * 1e3, labels * 1e9 / insns_count);
+        for (size_t v = 0; v < variants.size(); v++) {
+            printf("labels, %-6s scan:      %8.3f ms, %.2f ns/insn, speedup %.2fx\n", variants[v].name, scan_labels[v] * 1e3, scan_labels[v] * 1e9 / insns_count, labels / scan_labels[v]);
+        }
+    } catch (std::exception &e) {
+        std::cerr << e.what() << '\n';
+        result = 1;
+    }
+    if (path == synthetic_path) unlink(synthetic_path);
+    return result;
+}
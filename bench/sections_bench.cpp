@@ -0,0 +1,73 @@
+#include "bench.hpp"
+#include "synthetic_elf.hpp"
+#include "../disasm.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+// Disassembles a file with many code sections of very different sizes (a synthetic one of --size bytes of code in
+// --sections sections, or the ELF file given) into memory with 1, 2, 4, ... --jobs threads, best of --repeat runs
+// each, and prints the time and the speedup over one thread. Exits with 2 if some listing differs from the one-thread
+// listing.
+int main(int argc, char *argv[]) {
+    const char *path = nullptr;
+    size_t size = 64 << 20, sections = 400, max_jobs = 8, repeat = 3;
+    uint32_t seed = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc) size = std::stoull(argv[++i]);
+        else if (arg == "--sections" && i + 1 < argc) sections = std::max(1ul, std::stoul(argv[++i]));
+        else if (arg == "--jobs" && i + 1 < argc) max_jobs = std::max(1ul, std::stoul(argv[++i]));
+        else if (arg == "--seed" && i + 1 < argc) seed = std::stoul(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc) repeat = std::max(1ul, std::stoul(argv[++i]));
+        else path = argv[i];
+    }
+
+    int result = 0;
+    try {
+        std::vector<uint8_t> file;
+        ELF_Image image;
+        if (path == nullptr) {
+            file = Synthetic_ELF(seed).generate(size, sections);
+            image.assign(file.data(), file.size());
+        } else {
+            image.load(path);
+        }
+
+        ELF_Sections elf_sections = find_sections(image);
+        std::vector<uint32_t> sizes;
+        for (const Code_Section<ELF32> &section : elf_sections.code) sizes.push_back(section.header.sh_size);
+        std::sort(sizes.begin(), sizes.end());
+        uint64_t total = 0;
+        for (uint32_t section_size : sizes) total += section_size;
+        printf("%s: %zu code sections, %.1f MB; smallest %u bytes, median %u, largest %u (%.1f%% of the code)\n", path == nullptr ? "synthetic" : path, sizes.size(),
+               total / 1e6, sizes.front(), sizes[sizes.size() / 2], sizes.back(), 100.0 * sizes.back() / std::max<uint64_t>(1, total));
+
+        std::string reference;
+        double one_thread = 0;
+        for (size_t jobs = 1; jobs <= max_jobs; jobs *= 2) {
+            Disasm_Options options;
+            options.jobs = jobs;
+            Disasm_Context context;
+            double best = 1e9;
+            for (size_t r = 0; r < repeat; r++) {
+                context.output.clear();
+                auto start = std::chrono::steady_clock::now();
+                disasm(image, nullptr, options, context);
+                best = std::min(best, seconds_since(start));
+            }
+            if (jobs == 1) {
+                reference = context.output.view();
+                one_thread = best;
+            } else if (context.output.view() != reference) {
+                result = 2;
+            }
+            printf("  jobs %2zu: %8.3f ms, %.2fx\n", jobs, best * 1e3, one_thread / best);
+        }
+        if (result != 0) std::cerr << "the listing depends on the number of jobs\n";
+    } catch (std::exception &e) {
+        std::cerr << e.what() << '\n';
+        result = 1;
+    }
+    return result;
+}
@@ -0,0 +1,359 @@
+#ifndef LAB3_SYNTHETIC_ELF_HPP
+#define LAB3_SYNTHETIC_ELF_HPP
+
+#include "../elf.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+
+// Synthetic RV32IMC executables for the benchmarks. The instruction mix is roughly what gcc -O2 emits for
+// integer code: about half of the instructions compressed, one in six a jump or branch, functions of a few dozen
+// instructions with sized symbols. Same size and seed give the same file. generate64() makes an ELF64 file of RV64IMC
+// code instead, where part of the loads, stores and ALU operations are the 64-bit and *w ones. With more than one
+// code section, the functions are spread over .text and .text.N sections of wildly different sizes, back to back in
+// memory, the way -ffunction-sections and a linker script that keeps the sections apart lay them out. A nonzero
+// extension percent turns that share of the instructions into A, F, D, Zicsr and B ones, as in floating-point and
+// bit-manipulation heavy code.
+class Synthetic_ELF {
+private:
+    std::mt19937 random;
+    std::vector<uint8_t> text;
+    uint32_t compressed_percent;
+    uint32_t extension_percent;
+    bool rv64 = false;
+
+    uint32_t bits(uint32_t count) {
+        return random() & ((1u << count) - 1);
+    }
+
+    // Compiled code mostly uses a handful of registers and small immediates, which is what makes encodings repeat.
+    uint32_t reg() {
+        static const uint32_t hot[] = {1, 2, 8, 9, 10, 11, 12, 13, 14, 15};
+        if (random() % 100 < 70) return hot[random() % 10];
+        return 1 + bits(5) % 31;
+    }
+
+    uint32_t imm12() {
+        if (random() % 100 < 75) return (4 * (random() % 16) - 16) & 0xfff;
+        return bits(12);
+    }
+
+    uint32_t reg_() {
+        return bits(3);
+    }
+
+    void put32(uint32_t command) {
+        for (int i = 0; i < 4; i++) text.push_back(uint8_t(command >> (8 * i)));
+    }
+
+    void put16(uint32_t command) {
+        text.push_back(uint8_t(command));
+        text.push_back(uint8_t(command >> 8));
+    }
+
+    static uint32_t type_r(uint32_t opcode, uint32_t rd, uint32_t funct3, uint32_t rs1, uint32_t rs2, uint32_t funct7) {
+        return opcode | rd << 7 | funct3 << 12 | rs1 << 15 | rs2 << 20 | funct7 << 25;
+    }
+
+    static uint32_t type_i(uint32_t opcode, uint32_t rd, uint32_t funct3, uint32_t rs1, uint32_t imm) {
+        return opcode | rd << 7 | funct3 << 12 | rs1 << 15 | (imm & 0xfff) << 20;
+    }
+
+    static uint32_t type_s(uint32_t opcode, uint32_t funct3, uint32_t rs1, uint32_t rs2, uint32_t imm) {
+        return opcode | (imm & 0x1f) << 7 | funct3 << 12 | rs1 << 15 | rs2 << 20 | (imm >> 5 & 0x7f) << 25;
+    }
+
+    // Branch to a nearby even offset, forwards or backwards.
+    uint32_t type_b(uint32_t funct3, uint32_t rs1, uint32_t rs2) {
+        uint32_t imm = bits(12) << 1;
+        return 0b1100011 | (imm >> 11 & 1) << 7 | (imm >> 1 & 0xf) << 8 | funct3 << 12 | rs1 << 15 | rs2 << 20 | (imm >> 5 & 0x3f) << 25 | (imm >> 12 & 1) << 31;
+    }
+
+    void put_rv64() {
+        uint32_t kind = random() % 100;
+        if (kind < 40) {
+            put32(type_i(0b0000011, reg(), random() % 2 ? 3 : 6, reg(), imm12()));   // ld, lwu
+        } else if (kind < 65) {
+            put32(type_s(0b0100011, 3, reg(), reg(), imm12()));                     // sd
+        } else if (kind < 80) {
+            put32(type_i(0b0011011, reg(), 0, reg(), imm12()));                     // addiw
+        } else {
+            static const uint32_t funct3s[] = {0, 1, 5};
+            uint32_t funct3 = funct3s[random() % 3];
+            put32(type_r(0b0111011, reg(), funct3, reg(), reg(), funct3 != 1 && random() % 4 == 0 ? 0b0100000 : 0));   // addw, subw, sllw, srlw, sraw
+        }
+    }
+
+    // Floating-point values live in a few f registers too.
+    uint32_t freg() {
+        static const uint32_t hot[] = {10, 11, 12, 13, 14, 15, 8, 9};
+        return hot[random() % 8];
+    }
+
+    // A dynamic rounding mode most of the time, a static one (rne, rtz, rdn, rup, rmm) now and then.
+    uint32_t rm() {
+        return random() % 4 == 0 ? random() % 5 : 0b111;
+    }
+
+    void put_ext() {
+        uint32_t kind = random() % 100, fmt = (random() % 2);   // fmt: 0 for .s, 1 for .d
+        if (kind < 15) {
+            uint32_t funct3 = 2 + fmt;
+            if (random() % 2) put32(type_i(0b0000111, freg(), funct3, reg(), imm12()));   // flw, fld
+            else put32(type_s(0b0100111, funct3, reg(), freg(), imm12()));                // fsw, fsd
+        } else if (kind < 35) {
+            put32(type_r(0b1010011, freg(), rm(), freg(), freg(), (random() % 4) << 2 | fmt));   // fadd, fsub, fmul, fdiv
+        } else if (kind < 43) {
+            static const uint32_t opcodes[] = {0b1000011, 0b1000111, 0b1001011, 0b1001111};      // fmadd, fmsub, fnmsub, fnmadd
+            put32(opcodes[random() % 4] | freg() << 7 | rm() << 12 | freg() << 15 | freg() << 20 | fmt << 25 | freg() << 27);
+        } else if (kind < 48) {
+            put32(type_r(0b1010011, freg(), bits(1), freg(), freg(), 0b00101 << 2 | fmt));       // fmin, fmax
+            if (random() % 2) put32(type_r(0b1010011, freg(), random() % 3, freg(), freg(), 0b00100 << 2 | fmt));   // fsgnj, fsgnjn, fsgnjx
+        } else if (kind < 53) {
+            put32(type_r(0b1010011, reg(), random() % 3, freg(), freg(), 0b10100 << 2 | fmt));   // fle, flt, feq
+        } else if (kind < 60) {
+            uint32_t rs2 = bits(1) | (rv64 ? bits(1) << 1 : 0);   // w, wu, l, lu
+            if (random() % 2) put32(type_r(0b1010011, reg(), random() % 2 ? 0b001 : rm(), freg(), rs2, 0b11000 << 2 | fmt));   // fcvt.w.s, ...
+            else put32(type_r(0b1010011, freg(), fmt ? 0 : rm(), reg(), rs2 & 1, 0b11010 << 2 | fmt));            // fcvt.s.w, ...
+        } else if (kind < 63) {
+            put32(type_r(0b1010011, reg(), 0, reg(), 0, (random() % 2 ? 0b11100 : 0b11110) << 2));   // fmv.x.w, fmv.w.x
+        } else if (kind < 68) {
+            static const uint32_t csrs[] = {0x001, 0x002, 0x003, 0xc00, 0xc01, 0x300, 0x341, 0x342};
+            static const uint32_t funct3s[] = {1, 2, 3, 5, 6, 7};
+            put32(type_i(0b1110011, reg(), funct3s[random() % 6], random() % 2 ? 0 : reg(), csrs[random() % 8]));   // csrrw, ..., csrr, csrw
+        } else if (kind < 76) {
+            static const uint32_t funct5s[] = {0b00010, 0b00011, 0b00001, 0b00000, 0b00100, 0b01100, 0b01000, 0b10000, 0b11100};
+            uint32_t funct5 = funct5s[random() % 9];
+            put32(type_r(0b0101111, reg(), rv64 && random() % 2 ? 3 : 2, reg(), funct5 == 0b00010 ? 0 : reg(), funct5 << 2 | bits(2)));   // lr, sc, amo*
+        } else if (kind < 88) {
+            static const uint32_t ops[][2] = {{0b0010000, 2}, {0b0010000, 4}, {0b0010000, 6}, {0b0100000, 7}, {0b0100000, 6}, {0b0000101, 4},
+                                              {0b0000101, 6}, {0b0110000, 1}, {0b0100100, 1}, {0b0010100, 1}, {0b0100100, 5}};
+            const uint32_t *op = ops[random() % 11];
+            put32(type_r(0b0110011, reg(), op[1], reg(), reg(), op[0]));   // sh1add, ..., andn, orn, min, max, rol, bclr, bset, bext
+        } else {
+            static const uint32_t unary[] = {0x600, 0x601, 0x602, 0x604, 0x605};
+            uint32_t shamt = bits(rv64 ? 6 : 5);
+            switch (random() % 4) {
+                case 0: put32(type_i(0b0010011, reg(), 1, reg(), unary[random() % 5])); break;   // clz, ctz, cpop, sext.b, sext.h
+                case 1: put32(type_i(0b0010011, reg(), 5, reg(), random() % 2 ? 0x287 : (rv64 ? 0x6b8 : 0x698))); break;   // orc.b, rev8
+                case 2: put32(type_i(0b0010011, reg(), 1, reg(), (random() % 2 ? 0x280 : 0x480) | shamt)); break;   // bseti, bclri
+                default: put32(type_i(0b0010011, reg(), 5, reg(), 0x600 | shamt)); break;   // rori
+            }
+        }
+    }
+
+    void put_rv32() {
+        if (extension_percent != 0 && random() % 100 < extension_percent) return put_ext();
+        if (rv64 && random() % 4 == 0) return put_rv64();
+        uint32_t kind = random() % 100;
+        if (kind < 30) {
+            static const uint32_t alu_imm[] = {0, 2, 3, 4, 6, 7};
+            put32(type_i(0b0010011, reg(), alu_imm[random() % 6], reg(), imm12()));
+        } else if (kind < 45) {
+            static const uint32_t loads[] = {0, 1, 2, 4, 5};
+            put32(type_i(0b0000011, reg(), loads[random() % 5], reg(), imm12()));
+        } else if (kind < 55) {
+            put32(type_s(0b0100011, bits(2) % 3, reg(), reg(), imm12()));
+        } else if (kind < 65) {
+            uint32_t funct3 = bits(3);
+            put32(type_r(0b0110011, reg(), funct3, reg(), reg(), (funct3 == 0 || funct3 == 5) && random() % 4 == 0 ? 0b0100000 : 0));
+        } else if (kind < 70) {
+            put32(type_r(0b0110011, reg(), bits(3), reg(), reg(), 1));
+        } else if (kind < 75) {
+            put32((random() % 2 ? 0b0110111 : 0b0010111) | reg() << 7 | bits(20) << 12);
+        } else if (kind < 79) {
+            uint32_t funct3 = (random() % 2 ? 1 : 5);
+            put32(type_i(0b0010011, reg(), funct3, reg(), bits(5) | (funct3 == 5 && random() % 2 == 0 ? 0x400 : 0)));
+        } else if (kind < 90) {
+            static const uint32_t branches[] = {0, 1, 4, 5, 6, 7};
+            put32(type_b(branches[random() % 6], reg(), reg()));
+        } else if (kind < 96) {
+            uint32_t imm = bits(16) << 1;
+            put32(0b1101111 | (random() % 2) << 7 | (imm >> 12 & 0xff) << 12 | (imm >> 11 & 1) << 20 | (imm >> 1 & 0x3ff) << 21);
+        } else {
+            put32(type_i(0b1100111, random() % 4 == 0 ? 1 : 0, 0, reg(), random() % 4 == 0 ? bits(12) : 0));
+        }
+    }
+
+    void put_rvc() {
+        if (extension_percent != 0 && random() % 100 < extension_percent / 2) {
+            uint32_t funct3 = (random() % 2 ? 0b001 : 0b101);
+            if (random() % 2) put16(0b00 | reg_() << 2 | bits(2) << 5 | reg_() << 7 | bits(3) << 10 | funct3 << 13);   // c.fld, c.fsd
+            else put16(0b10 | bits(5) << 2 | bits(5) << 7 | bits(1) << 12 | funct3 << 13);   // c.fldsp, c.fsdsp
+            return;
+        }
+        if (rv64 && random() % 5 == 0) {
+            uint32_t funct3 = (random() % 2 ? 0b011 : 0b111);
+            if (random() % 2) put16(0b00 | reg_() << 2 | bits(2) << 5 | reg_() << 7 | bits(3) << 10 | funct3 << 13);   // c.ld, c.sd
+            else put16(0b10 | bits(5) << 2 | (funct3 == 0b011 ? reg() : bits(5)) << 7 | bits(1) << 12 | funct3 << 13);   // c.ldsp, c.sdsp
+            return;
+        }
+        uint32_t kind = random() % 100;
+        if (kind < 15) {
+            put16(0b01 | reg() << 2 | reg() << 7 | bits(1) << 12);                             // c.addi
+        } else if (kind < 25) {
+            put16(0b01 | bits(5) << 2 | reg() << 7 | bits(1) << 12 | 0b010 << 13);             // c.li
+        } else if (kind < 37) {
+            put16(0b10 | reg() << 2 | reg() << 7 | 0b100 << 13);                               // c.mv
+        } else if (kind < 45) {
+            put16(0b10 | reg() << 2 | reg() << 7 | 0b1001 << 12);                              // c.add
+        } else if (kind < 55) {
+            put16(0b00 | reg_() << 2 | bits(2) << 5 | reg_() << 7 | bits(3) << 10 | 0b010 << 13);   // c.lw
+        } else if (kind < 62) {
+            put16(0b00 | reg_() << 2 | bits(2) << 5 | reg_() << 7 | bits(3) << 10 | 0b110 << 13);   // c.sw
+        } else if (kind < 70) {
+            put16(0b10 | bits(5) << 2 | reg() << 7 | bits(1) << 12 | 0b010 << 13);             // c.lwsp
+        } else if (kind < 77) {
+            put16(0b10 | reg() << 2 | bits(6) << 7 | 0b110 << 13);                             // c.swsp
+        } else if (kind < 82) {
+            put16(0b01 | reg_() << 2 | bits(2) << 5 | reg_() << 7 | 0b100011 << 10);                 // c.sub, c.xor, c.or, c.and
+        } else if (kind < 88) {
+            put16(0b01 | bits(11) << 2 | (random() % 2 ? 0b101 : 0b001) << 13);              // c.j, c.jal
+        } else if (kind < 96) {
+            put16(0b01 | bits(5) << 2 | reg_() << 7 | bits(3) << 10 | (random() % 2 ? 0b110 : 0b111) << 13);   // c.beqz, c.bnez
+        } else {
+            put16(0b10 | reg() << 7 | (random() % 2) << 12 | 0b100 << 13);                    // c.jr, c.jalr
+        }
+    }
+
+    static void append(std::vector<uint8_t> &file, const void *data, size_t size) {
+        file.resize(file.size() + size);
+        memcpy(file.data() + file.size() - size, data, size);
+    }
+
+    static void align(std::vector<uint8_t> &file, size_t alignment) {
+        file.resize((file.size() + alignment - 1) / alignment * alignment);
+    }
+
+public:
+    static const uint32_t text_address = 0x10074;
+
+    explicit Synthetic_ELF(uint32_t seed, uint32_t compressed_percent = 50, uint32_t extension_percent = 0)
+            : random(seed), compressed_percent(compressed_percent), extension_percent(extension_percent) {}
+
+    // ELF file whose .text is `text_size` bytes (rounded down to an even number) of random RV32IMC code, in at most
+    // `code_sections` sections.
+    std::vector<uint8_t> generate(size_t text_size, size_t code_sections = 1) {
+        rv64 = false;
+        return write_file<ELF32>(generate_text(text_size), code_sections);
+    }
+
+    // The same for an ELF64 file of RV64IMC code.
+    std::vector<uint8_t> generate64(size_t text_size, size_t code_sections = 1) {
+        rv64 = true;
+        return write_file<ELF64>(generate_text(text_size), code_sections);
+    }
+
+private:
+    // Fills `text`; returns the offset and size of every function.
+    std::vector<std::pair<size_t, size_t>> generate_text(size_t text_size) {
+        text.clear();
+        text_size &= ~(size_t)1;
+        std::vector<std::pair<size_t, size_t>> functions;
+        while (text.size() + 4 <= text_size) {
+            size_t begin = text.size();
+            for (size_t i = 16 + random() % 96; i > 0 && text.size() + 4 <= text_size; i--) {
+                if (random() % 100 < compressed_percent) put_rvc(); else put_rv32();
+            }
+            functions.emplace_back(begin, text.size() - begin);
+        }
+        while (text.size() < text_size) put16(0x0001);   // c.nop
+        return functions;
+    }
+
+    // Function numbers where the code sections start: sizes drawn from 1 to 2048 relative units, each section ending
+    // at the first function boundary past its share. Sections that would be empty are dropped.
+    std::vector<size_t> split_sections(const std::vector<std::pair<size_t, size_t>> &functions, size_t code_sections) {
+        std::vector<size_t> firsts = {0};
+        if (code_sections <= 1 || functions.empty()) return firsts;
+        std::vector<double> weights(code_sections);
+        double total = 0;
+        for (double &weight : weights) total += (weight = 1 << (random() % 12));
+        double sum = 0;
+        size_t f = 0;
+        for (size_t n = 0; n + 1 < code_sections; n++) {
+            sum += weights[n];
+            size_t end = text.size() * (sum / total);
+            while (f < functions.size() && functions[f].first < end) f++;
+            if (f > firsts.back() && f < functions.size()) firsts.push_back(f);
+        }
+        return firsts;
+    }
+
+    template<typename ELF>
+    std::vector<uint8_t> write_file(const std::vector<std::pair<size_t, size_t>> &functions, size_t code_sections) {
+        using Address = typename ELF::Address;
+        using Symbol = typename ELF::Symbol;
+        std::vector<size_t> firsts = split_sections(functions, code_sections);
+        size_t code_count = firsts.size();
+        std::string strtab(1, '\0');
+        std::vector<Symbol> symbols(2);
+        symbols[1].st_value = text_address;   // .text section symbol
+        symbols[1].st_info = 0x03;
+        symbols[1].st_shndx = 1;
+        for (size_t n = 0, section = 1; n < functions.size(); n++) {
+            if (section < code_count && firsts[section] == n) section++;
+            Symbol symbol{};
+            symbol.st_name = strtab.size();
+            symbol.st_value = text_address + (Address)functions[n].first;
+            symbol.st_size = functions[n].second;
+            symbol.st_info = 0x12;
+            symbol.st_shndx = section;
+            strtab += (n % 8 == 7 ? ".L" : "func_") + std::to_string(n);
+            strtab.push_back('\0');
+            if (n % 8 == 7) symbol.st_info = 0x00, symbol.st_size = 0;
+            symbols.push_back(symbol);
+        }
+        std::string shstrtab(1, '\0');
+        std::vector<uint32_t> code_names;
+        for (size_t n = 0; n < code_count; n++) {
+            code_names.push_back(shstrtab.size());
+            shstrtab += (n == 0 ? std::string(".text") : ".text." + std::to_string(n));
+            shstrtab.push_back('\0');
+        }
+        uint32_t symtab_name = shstrtab.size(), strtab_name = symtab_name + 8, shstrtab_name = strtab_name + 8;
+        shstrtab.append(".symtab\0.strtab\0.shstrtab\0", 26);
+
+        std::vector<uint8_t> file(sizeof(typename ELF::File_Header));
+        size_t text_offset = file.size();
+        append(file, text.data(), text.size());
+        align(file, sizeof(Address));
+        size_t symtab_offset = file.size();
+        append(file, symbols.data(), symbols.size() * sizeof(Symbol));
+        size_t strtab_offset = file.size();
+        append(file, strtab.data(), strtab.size());
+        size_t shstrtab_offset = file.size();
+        append(file, shstrtab.data(), shstrtab.size());
+        align(file, sizeof(Address));
+        size_t shoff = file.size();
+
+        std::vector<typename ELF::Section_Header> sections(code_count + 4);
+        for (size_t n = 0; n < code_count; n++) {
+            size_t begin = functions.empty() ? 0 : functions[firsts[n]].first, end = (n + 1 < code_count ? functions[firsts[n + 1]].first : text.size());
+            sections[n + 1] = {code_names[n], 1, 0x6, text_address + (Address)begin, (Address)(text_offset + begin), (Address)(end - begin), 0, 0, 2, 0};
+        }
+        uint32_t symtab_index = code_count + 1;
+        sections[symtab_index] = {symtab_name, 2, 0, 0, (Address)symtab_offset, (Address)(symbols.size() * sizeof(Symbol)), symtab_index + 1, 1, sizeof(Address), sizeof(Symbol)};
+        sections[symtab_index + 1] = {strtab_name, 3, 0, 0, (Address)strtab_offset, (Address)strtab.size(), 0, 0, 1, 0};
+        sections[symtab_index + 2] = {shstrtab_name, 3, 0, 0, (Address)shstrtab_offset, (Address)shstrtab.size(), 0, 0, 1, 0};
+        append(file, sections.data(), sections.size() * sizeof(sections[0]));
+
+        typename ELF::File_Header header{};
+        memcpy(header.e_ident, ELF::xlen == 64 ? "\x7f" "ELF\x02\x01\x01" : "\x7f" "ELF\x01\x01\x01", 7);
+        header.e_type = 2;
+        header.e_machine = 0xf3;
+        header.e_version = 1;
+        header.e_entry = text_address;
+        header.e_shoff = shoff;
+        header.e_flags = 0x1;   // EF_RISCV_RVC
+        header.e_ehsize = sizeof(typename ELF::File_Header);
+        header.e_shentsize = sizeof(typename ELF::Section_Header);
+        header.e_shnum = sections.size();
+        header.e_shstrndx = symtab_index + 2;
+        memcpy(file.data(), &header, sizeof(header));
+        return file;
+    }
+};
+
+#endif //LAB3_SYNTHETIC_ELF_HPP
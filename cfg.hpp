@@ -0,0 +1,269 @@
+#ifndef LAB3_CFG_HPP
+#define LAB3_CFG_HPP
+
+#include "decode.hpp"
+#include "symbols.hpp"
+
+#include <vector>
+
+// Layout of the --cfg binary output: this header, then the arrays of Basic_Flow_Graph::Tables and the function names,
+// each at an 8-byte aligned offset from the start of the file, in host byte order. The addresses in Block and Function
+// are xlen bits wide and match the address column of a --format columnar file of the same ELF, so the two can be
+// joined.
+struct Flow_Graph_Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t xlen;   // 32 for ELF32 files, 64 for ELF64 ones
+    uint64_t text_address;
+    uint64_t text_size;
+    uint64_t functions_count;
+    uint64_t blocks_count;
+    uint64_t edges_count;
+    uint64_t strings_size;
+
+    uint64_t functions;             // Basic_Flow_Graph::Function[functions_count]
+    uint64_t blocks;                // Basic_Flow_Graph::Block[blocks_count]
+    uint64_t successor_offsets;     // uint32_t[blocks_count + 1]
+    uint64_t successors;            // uint32_t[edges_count]
+    uint64_t successor_kinds;       // uint8_t[edges_count], Basic_Flow_Graph::Edge
+    uint64_t predecessor_offsets;   // uint32_t[blocks_count + 1]
+    uint64_t predecessors;          // uint32_t[edges_count]
+    uint64_t names;                 // uint32_t[functions_count]: offsets into strings of NUL-terminated names
+    uint64_t strings;               // char[strings_size]
+};
+
+static const char flow_graph_magic[8] = {'R', 'V', 'C', 'F', 'G', '0', '1', 0};
+static const uint32_t flow_graph_version = 2;   // 2: xlen, and addresses as wide as the ELF class
+
+// Basic blocks and control-flow edges of every FUNC symbol in .text. A block starts at the symbol, at a jump or
+// branch target inside the function and after every instruction that ends a block; it ends before the next block or
+// after a jump, branch, return or indirect jump. Calls (jal/jalr with a link register, c.jal, c.jalr) do not end a
+// block. Edges only connect blocks of the same function: a jump elsewhere is a tail call and has no successor.
+//
+// Blocks are numbered in function order and by address inside a function; edges are in compressed sparse row form,
+// successors of block b being successors[successor_offsets[b] .. successor_offsets[b + 1]), and the same for
+// predecessors. Building takes two decoding passes over each function and a bitmap over its halfwords, so it is
+// linear in the size of .text. The code is decoded as RV32 or RV64 by the ELF class; Flow_Graph is the ELF32 graph.
+template<typename ELF>
+class Basic_Flow_Graph {
+public:
+    using Address = typename ELF::Address;
+
+    // How a block ends.
+    enum Exit : uint32_t {
+        EXIT_FALLTHROUGH,   // into the next block, which starts at a jump or branch target
+        EXIT_BRANCH,        // conditional branch: taken and fall-through successors
+        EXIT_JUMP,          // jal x0 or c.j inside the function
+        EXIT_TAIL,          // jal x0 or c.j out of the function
+        EXIT_RETURN,        // jalr x0, 0(ra) or c.jr ra
+        EXIT_INDIRECT,      // any other jalr x0 or c.jr: successors unknown
+        EXIT_END            // the function ends without a jump
+    };
+
+    enum Edge : uint8_t {
+        EDGE_FALLTHROUGH,
+        EDGE_TAKEN,
+        EDGE_JUMP
+    };
+
+    struct Block {
+        Address begin;
+        Address end;
+        uint32_t insns_count;
+        uint32_t exit;
+    };
+
+    struct Function {
+        Address begin;
+        Address end;
+        uint32_t symbol;   // index in .symtab
+        uint32_t first_block;
+        uint32_t blocks_count;
+        uint32_t reserved;   // zero; keeps the ELF64 layout free of padding
+    };
+
+    struct Tables {
+        const Function *functions;
+        size_t functions_count;
+        const Block *blocks;
+        size_t blocks_count;
+        const uint32_t *successor_offsets;     // blocks_count + 1
+        const uint32_t *successors;            // edges_count
+        const uint8_t *successor_kinds;        // edges_count, Edge
+        const uint32_t *predecessor_offsets;   // blocks_count + 1
+        const uint32_t *predecessors;          // edges_count
+        size_t edges_count;
+    };
+
+    // Block numbers of one adjacency list.
+    struct Range {
+        const uint32_t *first, *last;
+
+        const uint32_t *begin() const {
+            return first;
+        }
+
+        const uint32_t *end() const {
+            return last;
+        }
+
+        size_t size() const {
+            return last - first;
+        }
+    };
+
+private:
+    std::vector<Function> functions;
+    std::vector<Block> blocks;
+    std::vector<uint32_t> successor_offsets, successors, predecessor_offsets, predecessors;
+    std::vector<uint8_t> successor_kinds;
+    // Per function, over its halfwords: where instructions start, where blocks start, and the number of block
+    // starts before every 64-halfword word, which turns a target address into a block number.
+    std::vector<uint64_t> starts, leaders;
+    std::vector<uint32_t> ranks;
+
+    static bool is_jump(const Basic_Insn<Address> &insn) {
+        return (insn.mnemonic == MN_JAL && insn.rd == 0) || insn.mnemonic == MN_C_J;
+    }
+
+    static bool is_branch(const Basic_Insn<Address> &insn) {
+        return insn.has_target && insn.mnemonic != MN_JAL && insn.mnemonic != MN_C_JAL && insn.mnemonic != MN_C_J;
+    }
+
+    static bool is_indirect_jump(const Basic_Insn<Address> &insn) {
+        return (insn.mnemonic == MN_JALR && insn.rd == 0) || insn.mnemonic == MN_C_JR;
+    }
+
+    static bool test(const std::vector<uint64_t> &bits, size_t halfword) {
+        return (bits[halfword / 64] >> (halfword % 64)) & 1;
+    }
+
+    static void set(std::vector<uint64_t> &bits, size_t halfword) {
+        bits[halfword / 64] |= uint64_t(1) << (halfword % 64);
+    }
+
+    // Adds an edge from the last block to the block starting at `target`, if one does: that is, if `target` is inside
+    // [begin, end) of the function and an instruction of it starts there.
+    bool add_edge(Address target, Address begin, Address end, uint32_t first_block, Edge kind) {
+        if (target < begin || target >= end || (target - begin) % 2 != 0) return false;
+        size_t halfword = (target - begin) / 2;
+        if (!test(leaders, halfword)) return false;
+        uint64_t below = leaders[halfword / 64] & ((uint64_t(1) << (halfword % 64)) - 1);
+        successors.push_back(first_block + ranks[halfword / 64] + __builtin_popcountll(below));
+        successor_kinds.push_back(kind);
+        return true;
+    }
+
+    void add_function(const uint8_t *text, Address text_address, Address text_size, uint32_t symbol, Address begin, Address end) {
+        size_t words = ((end - begin + 1) / 2 + 63) / 64;
+        starts.assign(words, 0);
+        leaders.assign(words, 0);
+        ranks.resize(words);
+
+        // First pass: instruction starts, and the leaders among them.
+        set(leaders, 0);
+        for (Address address = begin; address < end;) {
+            size_t cur = address - text_address;
+            check_insn(text, cur, text_size);
+            Basic_Insn<Address> insn = decode_insn<ELF>(text + cur, address);
+            set(starts, (address - begin) / 2);
+            address += insn.length;
+            bool jump = is_jump(insn), branch = is_branch(insn);
+            if ((jump || branch) && insn.target >= begin && insn.target < end && (insn.target - begin) % 2 == 0) set(leaders, (insn.target - begin) / 2);
+            if ((jump || branch || is_indirect_jump(insn)) && address < end) set(leaders, (address - begin) / 2);
+        }
+        uint32_t count = 0;
+        for (size_t w = 0; w < words; w++) {
+            leaders[w] &= starts[w];
+            ranks[w] = count;
+            count += __builtin_popcountll(leaders[w]);
+        }
+
+        // Second pass: the blocks and their successors, which are numbered already.
+        uint32_t first_block = blocks.size();
+        functions.push_back({begin, end, symbol, first_block, count, 0});
+        bool open = false;   // the last block may still fall through into the next instruction
+        for (Address address = begin; address < end;) {
+            Basic_Insn<Address> insn = decode_insn<ELF>(text + (address - text_address), address);
+            if (test(leaders, (address - begin) / 2)) {
+                if (open) add_edge(address, begin, end, first_block, EDGE_FALLTHROUGH);
+                successor_offsets.push_back(successors.size());
+                blocks.push_back({address, address, 0, EXIT_FALLTHROUGH});
+            }
+            Block &block = blocks.back();
+            address += insn.length;
+            block.end = address;
+            block.insns_count++;
+            open = true;
+            if (is_branch(insn)) {
+                block.exit = EXIT_BRANCH;
+                add_edge(insn.target, begin, end, first_block, EDGE_TAKEN);
+                add_edge(address, begin, end, first_block, EDGE_FALLTHROUGH);
+                open = false;
+            } else if (is_jump(insn)) {
+                bool inside = (insn.target >= begin && insn.target < end);
+                block.exit = (inside ? EXIT_JUMP : EXIT_TAIL);
+                if (inside) add_edge(insn.target, begin, end, first_block, EDGE_JUMP);
+                open = false;
+            } else if (is_indirect_jump(insn)) {
+                block.exit = (insn.rs1 == 1 && insn.imm == 0 ? EXIT_RETURN : EXIT_INDIRECT);
+                open = false;
+            }
+        }
+        if (open) blocks.back().exit = EXIT_END;
+    }
+
+public:
+    // Builds the graph of every FUNC symbol of `symbols` (whose .symtab is `elf_symbols`) that starts in .text.
+    // Symbols at the same address are one function; a function is cut at the end of .text.
+    void build(const uint8_t *text, Address text_address, Address text_size, const Basic_Symbol_Index<Address> &symbols, const typename ELF::Symbol *elf_symbols) {
+        functions.clear();
+        blocks.clear();
+        successors.clear();
+        successor_kinds.clear();
+        successor_offsets.clear();
+        uint64_t text_end = (uint64_t)text_address + text_size;
+        const typename Basic_Symbol_Index<Address>::Tables &tables = symbols.tables();
+        for (size_t i = 0; i < tables.count; i++) {
+            const typename Basic_Symbol_Index<Address>::Interval &interval = tables.intervals[i];
+            if ((elf_symbols[interval.symbol].st_info & 0xf) != 2) continue;
+            if (interval.begin < text_address || interval.begin >= text_end || interval.end <= interval.begin) continue;
+            if (!functions.empty() && functions.back().begin == interval.begin) continue;
+            add_function(text, text_address, text_size, interval.symbol, interval.begin, (Address)std::min<uint64_t>(interval.end, text_end));
+        }
+        successor_offsets.push_back(successors.size());
+
+        // Predecessors: the successor lists turned around with a counting sort, so each list is in block order.
+        predecessor_offsets.assign(blocks.size() + 1, 0);
+        for (uint32_t to : successors) predecessor_offsets[to + 1]++;
+        for (size_t b = 0; b < blocks.size(); b++) predecessor_offsets[b + 1] += predecessor_offsets[b];
+        predecessors.resize(successors.size());
+        std::vector<uint32_t> next(predecessor_offsets.begin(), predecessor_offsets.end() - 1);
+        for (size_t b = 0; b < blocks.size(); b++) {
+            for (size_t e = successor_offsets[b]; e < successor_offsets[b + 1]; e++) predecessors[next[successors[e]]++] = b;
+        }
+    }
+
+    Tables tables() const {
+        return {functions.data(), functions.size(), blocks.data(), blocks.size(), successor_offsets.data(), successors.data(), successor_kinds.data(),
+                predecessor_offsets.data(), predecessors.data(), successors.size()};
+    }
+
+    Range successors_of(uint32_t block) const {
+        return {successors.data() + successor_offsets[block], successors.data() + successor_offsets[block + 1]};
+    }
+
+    Range predecessors_of(uint32_t block) const {
+        return {predecessors.data() + predecessor_offsets[block], predecessors.data() + predecessor_offsets[block + 1]};
+    }
+
+    // Bytes held by the graph itself, without the scratch space used while building it.
+    size_t memory_size() const {
+        return functions.size() * sizeof(Function) + blocks.size() * sizeof(Block) + (successor_offsets.size() + predecessor_offsets.size()) * sizeof(uint32_t) +
+               successors.size() * (2 * sizeof(uint32_t) + sizeof(uint8_t));
+    }
+};
+
+using Flow_Graph = Basic_Flow_Graph<ELF32>;
+
+#endif //LAB3_CFG_HPP
@@ -0,0 +1,212 @@
+#ifndef LAB3_COLUMNAR_HPP
+#define LAB3_COLUMNAR_HPP
+
+// Layout of the --format columnar output and a reader for it. This header depends on nothing else in the project, so
+// it can be copied into the programs that read the files.
+//
+// The file is a Columnar_Header followed by its arrays, each at an 8-byte aligned offset from the start of the file,
+// in host byte order. Addresses are xlen bits wide: uint32_t in files written for ELF32 inputs, uint64_t for ELF64
+// ones, which is the Address parameter of the Basic_* types below. Instruction i of .text (in address order) is
+// address[i], length[i], ..., target_label[i]; the operands column says which of rd, rs1, rs2 and imm are used, with
+// the same values as the Operands enum in insn.hpp. Labels, symbols, mnemonic and register names refer to the string
+// table by offset; every string is NUL-terminated.
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char columnar_magic[8] = {'R', 'V', 'C', 'O', 'L', '0', '1', 0};
+static const uint32_t columnar_version = 2;   // 2: xlen, and addresses as wide as the ELF class
+static const uint32_t columnar_no_label = UINT32_MAX;
+
+struct Columnar_Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t xlen;           // 32 or 64
+    uint64_t text_address;   // span of the code sections, see Basic_Sections::code in disasm.hpp
+    uint64_t text_size;
+    uint64_t mnemonics_count;
+    uint64_t insns_count;
+    uint64_t labels_count;
+    uint64_t symbols_count;
+    uint64_t strings_size;
+
+    // Offsets of the instruction columns, insns_count elements each.
+    uint64_t address;        // Address
+    uint64_t length;         // uint8_t: 2 or 4
+    uint64_t mnemonic;       // uint8_t: index into mnemonic_names
+    uint64_t operands;       // uint8_t
+    uint64_t rd, rs1, rs2;   // uint8_t: index into register_names
+    uint64_t imm;            // int32_t
+    uint64_t target_label;   // uint32_t: index into labels for jumps and branches, columnar_no_label for the rest
+
+    uint64_t labels;           // Basic_Columnar_Label[labels_count], sorted by address
+    uint64_t symbols;          // Basic_Columnar_Symbol[symbols_count], in .symtab order
+    uint64_t mnemonic_names;   // uint32_t[mnemonics_count]: string offsets
+    uint64_t register_names;   // uint32_t[32]: string offsets
+    uint64_t strings;          // char[strings_size]
+};
+
+// A symbol name or LOC_xxxxx, as in the text listing.
+template<typename Address>
+struct Basic_Columnar_Label {
+    Address address;
+    uint32_t name;
+    uint32_t length;
+};
+
+// A .symtab entry whose st_name is an offset into the string table of this file, with the fields in the ELF64 order
+// for both classes, so that neither has padding.
+template<typename Address>
+struct Basic_Columnar_Symbol {
+    uint32_t name;
+    uint8_t info;
+    uint8_t other;
+    uint16_t shndx;
+    Address value;
+    Address size;
+};
+
+using Columnar_Label = Basic_Columnar_Label<uint32_t>;
+using Columnar_Symbol = Basic_Columnar_Symbol<uint32_t>;
+
+// The xlen of the columnar file in `size` bytes at `data`, or 0 if it is not one. Tells which Basic_Columnar_File
+// reads it.
+inline uint32_t columnar_xlen(const uint8_t *data, size_t size) {
+    Columnar_Header header;
+    if (size < sizeof header) return 0;
+    memcpy(&header, data, sizeof header);
+    if (memcmp(header.magic, columnar_magic, sizeof columnar_magic) != 0 || header.version != columnar_version) return 0;
+    return header.xlen;
+}
+
+// Read-only view of a columnar file written for an ELF class with addresses of type Address: either memory the caller
+// owns (attach) or a file mapped by open(). Offsets and counts in the header are checked once against the size, so
+// the column pointers are safe to index up to size(); a file of the other class is rejected.
+template<typename Address>
+class Basic_Columnar_File {
+private:
+    const uint8_t *file_data = nullptr;
+    size_t file_size = 0;
+    void *mapping = nullptr;
+    const Columnar_Header *header = nullptr;
+
+    template<typename T>
+    const T *column(uint64_t offset, uint64_t count) const {
+        if (offset > file_size || count > (file_size - offset) / sizeof(T) || offset % alignof(T) != 0) throw std::runtime_error("Broken columnar file!");
+        return reinterpret_cast<const T *>(file_data + offset);
+    }
+
+public:
+    const Address *address = nullptr;
+    const uint8_t *length = nullptr, *mnemonic = nullptr, *operands = nullptr, *rd = nullptr, *rs1 = nullptr, *rs2 = nullptr;
+    const int32_t *imm = nullptr;
+    const uint32_t *target_label = nullptr;
+    const Basic_Columnar_Label<Address> *labels = nullptr;
+    const Basic_Columnar_Symbol<Address> *symbols = nullptr;
+
+    Basic_Columnar_File() = default;
+    Basic_Columnar_File(const Basic_Columnar_File &) = delete;
+    Basic_Columnar_File &operator=(const Basic_Columnar_File &) = delete;
+
+    ~Basic_Columnar_File() {
+        close();
+    }
+
+    // Uses `size` bytes at `data`, which must be 8-byte aligned and outlive the view.
+    void attach(const uint8_t *data, size_t size) {
+        close();
+        file_data = data;
+        file_size = size;
+        header = column<Columnar_Header>(0, 1);
+        if (memcmp(header->magic, columnar_magic, sizeof columnar_magic) != 0 || header->version != columnar_version) throw std::runtime_error("Not a columnar file!");
+        if (header->xlen != 8 * sizeof(Address)) throw std::runtime_error("Columnar file of another ELF class!");
+        uint64_t count = header->insns_count;
+        address = column<Address>(header->address, count);
+        length = column<uint8_t>(header->length, count);
+        mnemonic = column<uint8_t>(header->mnemonic, count);
+        operands = column<uint8_t>(header->operands, count);
+        rd = column<uint8_t>(header->rd, count);
+        rs1 = column<uint8_t>(header->rs1, count);
+        rs2 = column<uint8_t>(header->rs2, count);
+        imm = column<int32_t>(header->imm, count);
+        target_label = column<uint32_t>(header->target_label, count);
+        labels = column<Basic_Columnar_Label<Address>>(header->labels, header->labels_count);
+        symbols = column<Basic_Columnar_Symbol<Address>>(header->symbols, header->symbols_count);
+        column<uint32_t>(header->mnemonic_names, header->mnemonics_count);
+        column<uint32_t>(header->register_names, 32);
+        column<char>(header->strings, header->strings_size);
+    }
+
+    // Maps the file at `path`.
+    void open(const char *path) {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        struct stat st{};
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) ::close(fd);
+            throw std::runtime_error("Unable to open columnar file!");
+        }
+        void *ptr = (st.st_size > 0 ? mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED);
+        ::close(fd);
+        if (ptr == MAP_FAILED) throw std::runtime_error("Unable to open columnar file!");
+        try {
+            attach(static_cast<const uint8_t *>(ptr), st.st_size);
+        } catch (...) {
+            munmap(ptr, st.st_size);
+            throw;
+        }
+        mapping = ptr;
+    }
+
+    void close() {
+        if (mapping != nullptr) munmap(mapping, file_size);
+        mapping = nullptr;
+        file_data = nullptr;
+        file_size = 0;
+        header = nullptr;
+    }
+
+    const Columnar_Header &info() const {
+        return *header;
+    }
+
+    size_t size() const {
+        return header->insns_count;
+    }
+
+    // The string at `offset` of the string table, or an empty string if it is outside it.
+    std::string_view string(uint32_t offset) const {
+        if (offset >= header->strings_size) return "";
+        const char *begin = reinterpret_cast<const char *>(file_data + header->strings) + offset;
+        return std::string_view(begin, strnlen(begin, header->strings_size - offset));
+    }
+
+    std::string_view label_name(uint32_t label) const {
+        return (label < header->labels_count ? string(labels[label].name) : std::string_view());
+    }
+
+    std::string_view mnemonic_name(uint8_t id) const {
+        if (id >= header->mnemonics_count) return "";
+        uint32_t offset;
+        memcpy(&offset, file_data + header->mnemonic_names + id * sizeof offset, sizeof offset);
+        return string(offset);
+    }
+
+    std::string_view register_name(uint8_t id) const {
+        if (id >= 32) return "";
+        uint32_t offset;
+        memcpy(&offset, file_data + header->register_names + id * sizeof offset, sizeof offset);
+        return string(offset);
+    }
+};
+
+using Columnar_File = Basic_Columnar_File<uint32_t>;
+
+#endif //LAB3_COLUMNAR_HPP
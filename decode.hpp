@@ -0,0 +1,53 @@
+#ifndef LAB3_DECODE_HPP
+#define LAB3_DECODE_HPP
+
+#include "elf.hpp"
+#include "extensions.hpp"
+#include "insn.hpp"
+#include "rvc.hpp"
+#include "rvext.hpp"
+
+#include <vector>
+
+// Decodes the instruction at data placed at cur_address, as RV32 or RV64 code by the ELF class. An instruction of
+// an extension outside `extensions` (a set of Extension bits) decodes as unknown, with its length kept.
+template<typename ELF>
+inline Basic_Insn<typename ELF::Address> decode_insn(const uint8_t *data, typename ELF::Address cur_address, uint32_t extensions = EXT_ALL) {
+    uint16_t part1 = read_parcel(data);
+    Basic_Insn<typename ELF::Address> insn = ((part1 & 0b11) != 0b11 ? decode_rvc<ELF>(part1, cur_address) : decode_rvim<ELF>((read_parcel(data + 2) << 16) + part1, cur_address));
+    if ((extension_of[insn.mnemonic] & ~extensions) != 0) {
+        Basic_Insn<typename ELF::Address> unknown{};
+        unknown.address = cur_address;
+        unknown.length = insn.length;
+        return unknown;
+    }
+    return insn;
+}
+
+inline DecodedInsn decode_insn(const uint8_t *data, uint32_t cur_address, uint32_t extensions = EXT_ALL) {
+    return decode_insn<ELF32>(data, cur_address, extensions);
+}
+
+// Throws if the instruction starting at data[cur] runs past data[size - 1].
+inline void check_insn(const uint8_t *data, size_t cur, size_t size) {
+    if (cur + 2 > size || ((data[cur] & 0b11) == 0b11 && cur + 4 > size)) throw FileFormatException("An error occurred while reading!");
+}
+
+// Decodes the instructions of data[0, size) placed at `address` and appends them to `insns`.
+// Returns the number of bytes consumed, which is less than size only if the last instruction is cut off.
+template<typename ELF>
+inline size_t decode_range(const uint8_t *data, size_t size, typename ELF::Address address, std::vector<Basic_Insn<typename ELF::Address>> &insns, uint32_t extensions = EXT_ALL) {
+    size_t cur = 0;
+    while (cur + 2 <= size) {
+        if ((data[cur] & 0b11) == 0b11 && cur + 4 > size) break;
+        insns.push_back(decode_insn<ELF>(data + cur, address + cur, extensions));
+        cur += insns.back().length;
+    }
+    return cur;
+}
+
+inline size_t decode_range(const uint8_t *data, size_t size, uint32_t address, std::vector<DecodedInsn> &insns, uint32_t extensions = EXT_ALL) {
+    return decode_range<ELF32>(data, size, address, insns, extensions);
+}
+
+#endif //LAB3_DECODE_HPP
@@ -0,0 +1,976 @@
+#include "disasm.hpp"
+#include "cfg.hpp"
+#include "decode.hpp"
+#include "columnar.hpp"
+#include "format.hpp"
+#include "index_file.hpp"
+#include "parallel.hpp"
+#include "prescan.hpp"
+#include "stats.hpp"
+
+#include <limits>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// The NUL-terminated string at `offset` of a string table of `sz` bytes, cut at its end.
+std::string_view get_string(const uint8_t table[], size_t sz, uint32_t offset) {
+    size_t begin = std::min<size_t>(offset, sz), cur = begin;
+    while (cur < sz && table[cur] != 0) cur++;
+    return std::string_view(reinterpret_cast<const char *>(table) + begin, cur - begin);
+}
+
+template<typename Section_Header>
+std::string_view get_section_name(const Section_Header &section_header, const uint8_t shstrtab[], size_t sz) {
+    return get_string(shstrtab, sz, section_header.sh_name);
+}
+
+std::string_view get_type(uint8_t type) {
+    if (type == 0) return "NOTYPE";
+    if (type == 1) return "OBJECT";
+    if (type == 2) return "FUNC";
+    if (type == 3) return "SECTION";
+    if (type == 4) return "FILE";
+    if (type == 5) return "COMMON";
+    if (type == 6) return "TLS";
+    if (type == 10) return "LOOS";    ///NOT SURE
+    if (type == 12) return "HIOS";    ///NOT SURE
+    if (type == 13) return "LOPROC";  ///NOT SURE
+    if (type == 15) return "HIPROC";  ///NOT SURE
+    return "";
+}
+
+std::string_view get_bind(uint8_t bind) {
+    if (bind == 0) return "LOCAL";
+    if (bind == 1) return "GLOBAL";
+    if (bind == 2) return "WEAK";
+    if (bind == 10) return "LOOS";    ///NOT SURE
+    if (bind == 12) return "HIOS";    ///NOT SURE
+    if (bind == 13) return "LOPROC";  ///NOT SURE
+    if (bind == 15) return "HIPROC";  ///NOT SURE
+    return "";
+}
+
+std::string_view get_vis(uint8_t vis) {
+    if (vis == 0) return "DEFAULT";
+    if (vis == 1) return "INTERNAL";
+    if (vis == 2) return "HIDDEN";
+    if (vis == 3) return "PROTECTED";
+    return "";
+}
+
+// Name of a special section index, or the index itself written to `buffer`.
+std::string_view get_index(uint16_t index, char buffer[8]) {
+    if (index == 0x0000) return "UNDEF";
+    if (index == 0xff00) return "BEFORE"; ///NOT SURE
+    if (index == 0xff01) return "AFTER";  ///NOT SURE
+    if (index == 0xff20) return "LOOS";   ///NOT SURE
+    if (index == 0xff3f) return "HIOS";   ///NOT SURE
+    if (index == 0xfff1) return "ABS";
+    if (index == 0xfff2) return "COMMON"; ///NOT SURE
+    if (index == 0xffff) return "XINDEX"; ///NOT SURE
+    return std::string_view(buffer, put_int(buffer, index) - buffer);
+}
+
+// Writes one row of the .symtab listing: "[%4i] 0x%-15X %5i %-8s %-8s %-8s %6s %s\n". The size is printed signed, as
+// it always has been.
+template<typename Symbol>
+void print_symbol_info(const Symbol &symbol, size_t idx, std::string_view name, Output_Buffer &output) {
+    uint8_t type = (symbol.st_info & 0xf), bind = (symbol.st_info >> 4), vis = (symbol.st_other & 0b11);
+    char *out = output.reserve(96 + name.size());
+    *out++ = '[';
+    out = put_int_right(out, (int)idx, 4);
+    out = put_str(out, "] 0x");
+    char value[16];
+    out = put_left(out, std::string_view(value, put_hex_upper(value, symbol.st_value) - value), 15);
+    *out++ = ' ';
+    out = put_int_right(out, (std::make_signed_t<decltype(symbol.st_size)>)symbol.st_size, 5);
+    *out++ = ' ';
+    out = put_left(out, get_type(type), 8);
+    *out++ = ' ';
+    out = put_left(out, get_bind(bind), 8);
+    *out++ = ' ';
+    out = put_left(out, get_vis(vis), 8);
+    *out++ = ' ';
+    char index[8];
+    out = put_right(out, get_index(symbol.st_shndx, index), 6);
+    *out++ = ' ';
+    out = put_str(out, name);
+    *out++ = '\n';
+    output.commit(out);
+}
+
+// Writes one .symtab row as a JSON object on its own line, with the fields of print_symbol_info(). The name is the
+// symbol's own name from .strtab.
+template<typename Symbol>
+void print_symbol_json(const Symbol &symbol, size_t idx, std::string_view name, Output_Buffer &output) {
+    char *out = output.reserve(256 + 6 * name.size());
+    out = put_str(out, "{\"type\":\"symbol\",\"index\":");
+    out = put_int(out, idx);
+    out = put_str(out, ",\"value\":");
+    out = put_uint(out, symbol.st_value);
+    out = put_str(out, ",\"size\":");
+    out = put_uint(out, symbol.st_size);
+    out = put_str(out, ",\"symbol_type\":\"");
+    out = put_str(out, get_type(symbol.st_info & 0xf));
+    out = put_str(out, "\",\"bind\":\"");
+    out = put_str(out, get_bind(symbol.st_info >> 4));
+    out = put_str(out, "\",\"vis\":\"");
+    out = put_str(out, get_vis(symbol.st_other & 0b11));
+    out = put_str(out, "\",\"section\":\"");
+    char index[8];
+    out = put_str(out, get_index(symbol.st_shndx, index));
+    out = put_str(out, "\",\"name\":");
+    out = put_json_string(out, name);
+    out = put_str(out, "}\n");
+    output.commit(out);
+}
+
+// Writes the .symtab part of the listing.
+template<typename ELF>
+void print_symtab(const Basic_Sections<ELF> &sections, const Basic_Label_Index<typename ELF::Address> &labels, Output_Format format, Output_Buffer &output) {
+    if (format == FORMAT_JSONL) {
+        for (size_t i = 0; i < sections.symbols_count; i++) {
+            const typename ELF::Symbol &symbol = sections.symbols[i];
+            print_symbol_json(symbol, i, get_string(sections.strtab, sections.strtab_header.sh_size, symbol.st_name), output);
+        }
+        return;
+    }
+    output.write("\n.symtab\n");
+    output.print("%s %-15s %7s %-8s %-8s %-8s %6s %s\n", "Symbol", "Value", "Size", "Type", "Bind", "Vis", "Index", "Name");
+
+    for (size_t i = 0; i < sections.symbols_count; i++) {
+        const typename ELF::Symbol &symbol = sections.symbols[i];
+        if (symbol.st_name != 0) {
+            print_symbol_info(symbol, i, labels.find(symbol.st_value), output);
+        } else {
+            print_symbol_info(symbol, i, "", output);
+        }
+    }
+}
+
+// Collects the targets of jumps and branches in .text[begin, end). Returns where the instruction after the
+// last one started before `end` begins. Only the candidates of the pre-scan are decoded; extensions have no jumps,
+// so they are decoded with all of them.
+template<typename ELF = ELF32>
+size_t collect_targets(const uint8_t *text, size_t begin, size_t end, size_t size, typename ELF::Address address, std::vector<typename ELF::Address> &targets) {
+    size_t cur = scan_starts(text, begin, end, [&](size_t offset) {
+        check_insn(text, offset, size);
+        auto insn = decode_insn<ELF>(text + offset, address + offset);
+        if (insn.has_target) targets.push_back(insn.target);
+    });
+    if (cur > size) throw FileFormatException("An error occurred while reading!");
+    return cur;
+}
+
+// Writes one instruction of the listing in `format` (text or JSON Lines).
+template<typename Address>
+void print_entry(const Basic_Insn<Address> &insn, const Basic_Label_Index<Address> &labels, Output_Format format, Output_Buffer &output) {
+    std::string_view mark = labels.find(insn.address), mark_offset = (insn.has_target ? labels.find(insn.target) : std::string_view());
+    if (format == FORMAT_JSONL) print_insn_json(insn, mark, mark_offset, output);
+    else print_insn(insn, mark, mark_offset, output);
+}
+
+// Writes the listing of .text[begin, end), counting its instructions into `stats` if it is not nullptr. Returns the
+// same position as collect_targets().
+template<typename ELF = ELF32>
+size_t print_text(const uint8_t *text, size_t begin, size_t end, size_t size, typename ELF::Address address, const Basic_Label_Index<typename ELF::Address> &labels, uint32_t extensions, Output_Format format, Output_Buffer &output, Disasm_Stats *stats = nullptr) {
+    size_t cur = begin;
+    while (cur < end) {
+        check_insn(text, cur, size);
+        auto insn = decode_insn<ELF>(text + cur, address + cur, extensions);
+        if (stats_enabled && stats != nullptr) stats->count<ELF::xlen>(text + cur, insn.mnemonic);
+        print_entry(insn, labels, format, output);
+        cur += insn.length;
+    }
+    return cur;
+}
+
+// Writes the listing of already decoded instructions.
+template<typename Address>
+void print_text(const std::vector<Basic_Insn<Address>> &insns, const Basic_Label_Index<Address> &labels, Output_Format format, Output_Buffer &output) {
+    for (const Basic_Insn<Address> &insn : insns) print_entry(insn, labels, format, output);
+}
+
+// Walks .text[begin, end) in windows of `window` bytes with pass(from, to), which returns where it stopped.
+// With `release`, the pages of the image behind every finished window are dropped from memory.
+template<typename Pass>
+void for_windows(const ELF_Image &image, uint64_t text_offset, size_t begin, size_t end, size_t window, bool release, Pass pass) {
+    for (size_t cur = begin; cur < end;) {
+        size_t next = pass(cur, end - cur > window ? cur + window : end);
+        if (release) image.release(text_offset + cur, next - cur);
+        cur = next;
+    }
+}
+
+// Zeros after `size` bytes of a columnar array, so that the next one starts 8-byte aligned.
+void put_padding(Output_Buffer &output, uint64_t size) {
+    char *out = output.reserve(8);
+    size_t padding = (8 - size % 8) % 8;
+    memset(out, 0, padding);
+    output.commit(out + padding);
+}
+
+// Writes one instruction column: field(insn) of every instruction in address order, then zeros up to a multiple of 8.
+// The values go straight from the decoded instructions into the output buffer, a block at a time.
+template<typename T, typename Address, typename Field>
+void put_column(const std::vector<std::vector<Basic_Insn<Address>>> &chunk_insns, size_t chunks, Output_Buffer &output, Field field) {
+    static const size_t block = 4096;
+    size_t count = 0;
+    for (size_t k = 0; k < chunks; k++) {
+        const std::vector<Basic_Insn<Address>> &insns = chunk_insns[k];
+        for (size_t i = 0; i < insns.size(); i += block) {
+            size_t n = std::min(block, insns.size() - i);
+            char *out = output.reserve(n * sizeof(T));
+            for (size_t j = 0; j < n; j++) {
+                T value = field(insns[i + j]);
+                memcpy(out + j * sizeof(T), &value, sizeof(T));
+            }
+            output.commit(out + n * sizeof(T));
+        }
+        count += insns.size();
+    }
+    put_padding(output, count * sizeof(T));
+}
+
+// Writes the --format columnar file described in columnar.hpp for the decoded code sections in chunk_insns, with
+// addresses of the ELF class.
+template<typename ELF>
+void print_columnar(const Basic_Sections<ELF> &sections, const std::vector<std::vector<Basic_Insn<typename ELF::Address>>> &chunk_insns, size_t chunks, const Basic_Label_Index<typename ELF::Address> &labels, Output_Buffer &output) {
+    using Address = typename ELF::Address;
+    using Insn = Basic_Insn<Address>;
+    using Label = Basic_Columnar_Label<Address>;
+    using Symbol = Basic_Columnar_Symbol<Address>;
+    const typename Basic_Label_Index<Address>::Tables &label_tables = labels.tables();
+    size_t strtab_size = sections.strtab_header.sh_size;
+    uint64_t insns_count = 0;
+    for (size_t k = 0; k < chunks; k++) insns_count += chunk_insns[k].size();
+
+    // Strings: the label names, .strtab, the mnemonic and register names, and a final NUL for out-of-range names.
+    uint32_t strtab_base = label_tables.arena_size, names_base = strtab_base + strtab_size, names_size = 0;
+    for (std::string_view name : mnemonic_names) names_size += name.size() + 1;
+    for (std::string_view name : register_names) names_size += name.size() + 1;
+
+    Columnar_Header header{};
+    memcpy(header.magic, columnar_magic, sizeof header.magic);
+    header.version = columnar_version;
+    header.xlen = ELF::xlen;
+    // The span of the code sections, which is .text alone in most files.
+    uint64_t text_begin = UINT64_MAX, text_end = 0;
+    for (const Code_Section<ELF> &section : sections.code) {
+        if (section.header.sh_size == 0) continue;
+        text_begin = std::min<uint64_t>(text_begin, section.header.sh_addr);
+        text_end = std::max<uint64_t>(text_end, (uint64_t)section.header.sh_addr + section.header.sh_size);
+    }
+    if (text_begin > text_end) text_begin = text_end = sections.text_header.sh_addr;
+    header.text_address = text_begin;
+    header.text_size = text_end - text_begin;
+    header.mnemonics_count = MN_COUNT;
+    header.insns_count = insns_count;
+    header.labels_count = label_tables.entries_count;
+    header.symbols_count = sections.symbols_count;
+    header.strings_size = names_base + names_size + 1;
+    uint64_t end = sizeof header;
+    auto place = [&end](uint64_t size) {
+        uint64_t offset = end;
+        end = (end + size + 7) / 8 * 8;
+        return offset;
+    };
+    header.address = place(insns_count * sizeof(Address));
+    header.length = place(insns_count);
+    header.mnemonic = place(insns_count);
+    header.operands = place(insns_count);
+    header.rd = place(insns_count);
+    header.rs1 = place(insns_count);
+    header.rs2 = place(insns_count);
+    header.imm = place(insns_count * sizeof(int32_t));
+    header.target_label = place(insns_count * sizeof(uint32_t));
+    header.labels = place(header.labels_count * sizeof(Label));
+    header.symbols = place(header.symbols_count * sizeof(Symbol));
+    header.mnemonic_names = place(MN_COUNT * sizeof(uint32_t));
+    header.register_names = place(32 * sizeof(uint32_t));
+    header.strings = place(header.strings_size);
+    output.write(std::string_view(reinterpret_cast<const char *>(&header), sizeof header));
+
+    put_column<Address>(chunk_insns, chunks, output, [](const Insn &insn) { return insn.address; });
+    put_column<uint8_t>(chunk_insns, chunks, output, [](const Insn &insn) { return insn.length; });
+    put_column<uint8_t>(chunk_insns, chunks, output, [](const Insn &insn) { return insn.mnemonic; });
+    put_column<uint8_t>(chunk_insns, chunks, output, [](const Insn &insn) { return insn.operands; });
+    put_column<uint8_t>(chunk_insns, chunks, output, [](const Insn &insn) { return insn.rd; });
+    put_column<uint8_t>(chunk_insns, chunks, output, [](const Insn &insn) { return insn.rs1; });
+    put_column<uint8_t>(chunk_insns, chunks, output, [](const Insn &insn) { return insn.rs2; });
+    put_column<int32_t>(chunk_insns, chunks, output, [](const Insn &insn) { return insn.imm; });
+    put_column<uint32_t>(chunk_insns, chunks, output, [&labels](const Insn &insn) {
+        return (insn.has_target ? labels.id(insn.target) : columnar_no_label);
+    });
+
+    static_assert(sizeof(Label) == sizeof(typename Basic_Label_Index<Address>::Entry), "labels are written as they are");
+    output.write(std::string_view(reinterpret_cast<const char *>(label_tables.entries), label_tables.entries_count * sizeof(Label)));
+    put_padding(output, label_tables.entries_count * sizeof(Label));
+    for (size_t i = 0; i < sections.symbols_count; i++) {
+        const typename ELF::Symbol &symbol = sections.symbols[i];
+        Symbol record{symbol.st_name < strtab_size ? strtab_base + symbol.st_name : (uint32_t)header.strings_size - 1, symbol.st_info, symbol.st_other, symbol.st_shndx, symbol.st_value, symbol.st_size};
+        output.write(std::string_view(reinterpret_cast<const char *>(&record), sizeof record));
+    }
+    uint32_t name = names_base;
+    for (std::string_view mnemonic : mnemonic_names) {
+        output.write(std::string_view(reinterpret_cast<const char *>(&name), sizeof name));
+        name += mnemonic.size() + 1;
+    }
+    put_padding(output, MN_COUNT * sizeof(uint32_t));
+    for (std::string_view reg : register_names) {
+        output.write(std::string_view(reinterpret_cast<const char *>(&name), sizeof name));
+        name += reg.size() + 1;
+    }
+    output.write(std::string_view(label_tables.arena, label_tables.arena_size));
+    output.write(std::string_view(reinterpret_cast<const char *>(sections.strtab), strtab_size));
+    for (std::string_view mnemonic : mnemonic_names) {
+        output.write(mnemonic);
+        output.write(std::string_view("", 1));
+    }
+    for (std::string_view reg : register_names) {
+        output.write(reg);
+        output.write(std::string_view("", 1));
+    }
+    output.write(std::string_view("", 1));
+    put_padding(output, header.strings_size);
+}
+
+// str escaped for the inside of a DOT string literal: at most 2 * str.size() bytes. Control characters become '?'.
+char *put_dot_escaped(char *out, std::string_view str) {
+    for (char c : str) {
+        if (c == '"' || c == '\\') *out++ = '\\';
+        *out++ = ((unsigned char)c < 0x20 ? '?' : c);
+    }
+    return out;
+}
+
+template<typename Graph>
+std::string_view get_exit(uint32_t exit) {
+    if (exit == Graph::EXIT_TAIL) return "tail call";
+    if (exit == Graph::EXIT_RETURN) return "return";
+    if (exit == Graph::EXIT_INDIRECT) return "indirect jump";
+    if (exit == Graph::EXIT_END) return "falls off the end";
+    return "";
+}
+
+// Writes the graph as a Graphviz digraph: a cluster per function named after its symbol, a node per block with its
+// label, address range, instruction count and how it ends if that is not a jump or branch. Taken branches are
+// labelled T, fall-through edges are dashed.
+template<typename ELF>
+void print_dot(const Basic_Sections<ELF> &sections, const Basic_Flow_Graph<ELF> &graph, const Basic_Label_Index<typename ELF::Address> &labels, Output_Buffer &output) {
+    typename Basic_Flow_Graph<ELF>::Tables tables = graph.tables();
+    output.write("digraph cfg {\n    node [shape=box, fontname=\"monospace\"];\n");
+    for (size_t f = 0; f < tables.functions_count; f++) {
+        const typename Basic_Flow_Graph<ELF>::Function &function = tables.functions[f];
+        std::string_view name = get_string(sections.strtab, sections.strtab_header.sh_size, sections.symbols[function.symbol].st_name);
+        char *out = output.reserve(64 + 2 * name.size());
+        out = put_str(out, "    subgraph cluster_");
+        out = put_int(out, f);
+        out = put_str(out, " {\n        label=\"");
+        out = put_dot_escaped(out, name);
+        out = put_str(out, "\";\n");
+        output.commit(out);
+        for (uint32_t b = function.first_block; b < function.first_block + function.blocks_count; b++) {
+            const typename Basic_Flow_Graph<ELF>::Block &block = tables.blocks[b];
+            std::string_view mark = labels.find(block.begin), exit = get_exit<Basic_Flow_Graph<ELF>>(block.exit);
+            out = output.reserve(160 + 2 * mark.size());
+            out = put_str(out, "        b");
+            out = put_int(out, b);
+            out = put_str(out, " [label=\"");
+            if (!mark.empty()) {
+                out = put_dot_escaped(out, mark);
+                out = put_str(out, "\\n");
+            }
+            out = put_str(out, "0x");
+            out = put_address(out, block.begin);
+            out = put_str(out, "-0x");
+            out = put_address(out, block.end);
+            out = put_str(out, "\\n");
+            out = put_int(out, block.insns_count);
+            out = put_str(out, block.insns_count == 1 ? " insn" : " insns");
+            if (!exit.empty()) {
+                out = put_str(out, ", ");
+                out = put_str(out, exit);
+            }
+            out = put_str(out, "\"];\n");
+            output.commit(out);
+        }
+        for (uint32_t b = function.first_block; b < function.first_block + function.blocks_count; b++) {
+            for (uint32_t e = tables.successor_offsets[b]; e < tables.successor_offsets[b + 1]; e++) {
+                out = output.reserve(64);
+                out = put_str(out, "        b");
+                out = put_int(out, b);
+                out = put_str(out, " -> b");
+                out = put_int(out, tables.successors[e]);
+                if (tables.successor_kinds[e] == Basic_Flow_Graph<ELF>::EDGE_TAKEN) out = put_str(out, " [label=\"T\"]");
+                if (tables.successor_kinds[e] == Basic_Flow_Graph<ELF>::EDGE_FALLTHROUGH) out = put_str(out, " [style=dashed]");
+                out = put_str(out, ";\n");
+                output.commit(out);
+            }
+        }
+        output.write("    }\n");
+    }
+    output.write("}\n");
+}
+
+// Writes the graph in the layout of Flow_Graph_Header.
+template<typename ELF>
+void print_graph_binary(const Basic_Sections<ELF> &sections, const Basic_Flow_Graph<ELF> &graph, Output_Buffer &output) {
+    using Graph = Basic_Flow_Graph<ELF>;
+    typename Graph::Tables tables = graph.tables();
+    std::vector<uint32_t> names(tables.functions_count);
+    uint64_t strings_size = 0;
+    for (size_t f = 0; f < tables.functions_count; f++) {
+        names[f] = strings_size;
+        strings_size += get_string(sections.strtab, sections.strtab_header.sh_size, sections.symbols[tables.functions[f].symbol].st_name).size() + 1;
+    }
+
+    Flow_Graph_Header header{};
+    memcpy(header.magic, flow_graph_magic, sizeof header.magic);
+    header.version = flow_graph_version;
+    header.xlen = ELF::xlen;
+    header.text_address = sections.text_header.sh_addr;
+    header.text_size = sections.text_header.sh_size;
+    header.functions_count = tables.functions_count;
+    header.blocks_count = tables.blocks_count;
+    header.edges_count = tables.edges_count;
+    header.strings_size = strings_size;
+    uint64_t end = sizeof header;
+    auto place = [&end](uint64_t size) {
+        uint64_t offset = end;
+        end = (end + size + 7) / 8 * 8;
+        return offset;
+    };
+    uint64_t offsets_size = (tables.blocks_count + 1) * sizeof(uint32_t), edges_size = tables.edges_count * sizeof(uint32_t);
+    header.functions = place(tables.functions_count * sizeof(typename Graph::Function));
+    header.blocks = place(tables.blocks_count * sizeof(typename Graph::Block));
+    header.successor_offsets = place(offsets_size);
+    header.successors = place(edges_size);
+    header.successor_kinds = place(tables.edges_count);
+    header.predecessor_offsets = place(offsets_size);
+    header.predecessors = place(edges_size);
+    header.names = place(tables.functions_count * sizeof(uint32_t));
+    header.strings = place(strings_size);
+
+    auto put_array = [&output](const void *data, uint64_t size) {
+        output.write(std::string_view(static_cast<const char *>(data), size));
+        put_padding(output, size);
+    };
+    put_array(&header, sizeof header);
+    put_array(tables.functions, tables.functions_count * sizeof(typename Graph::Function));
+    put_array(tables.blocks, tables.blocks_count * sizeof(typename Graph::Block));
+    put_array(tables.successor_offsets, offsets_size);
+    put_array(tables.successors, edges_size);
+    put_array(tables.successor_kinds, tables.edges_count);
+    put_array(tables.predecessor_offsets, offsets_size);
+    put_array(tables.predecessors, edges_size);
+    put_array(names.data(), names.size() * sizeof(uint32_t));
+    for (size_t f = 0; f < tables.functions_count; f++) {
+        output.write(get_string(sections.strtab, sections.strtab_header.sh_size, sections.symbols[tables.functions[f].symbol].st_name));
+        output.write(std::string_view("", 1));
+    }
+    put_padding(output, strings_size);
+}
+
+template<typename ELF>
+Basic_Sections<ELF> find_elf_sections(const ELF_Image &image) {
+    const typename ELF::File_Header &file_header = *image.view<typename ELF::File_Header>(0);
+    if (file_header.e_ident[0] != 0x7f || file_header.e_ident[1] != 0x45 || file_header.e_ident[2] != 0x4c || file_header.e_ident[3] != 0x46) throw FileFormatException("Wrong format of input file!");
+
+    const typename ELF::Section_Header &shstrtab_header = *image.view<typename ELF::Section_Header>(file_header.e_shoff + (uint64_t)file_header.e_shstrndx * file_header.e_shentsize);
+    const uint8_t *shstrtab = image.view<uint8_t>(shstrtab_header.sh_offset, shstrtab_header.sh_size);
+    typename ELF::Section_Header text_header{}, symtab_header{}, strtab_header{};
+    std::vector<Code_Section<ELF>> code;
+    size_t text_position = 0;
+    std::string_view arch;
+
+    for (size_t i = 0; i < file_header.e_shnum; i++) {
+        const typename ELF::Section_Header &section_header = *image.view<typename ELF::Section_Header>(file_header.e_shoff + i * file_header.e_shentsize);
+
+        if (section_header.sh_name != 0) {
+            std::string_view name = get_section_name(section_header, shstrtab, shstrtab_header.sh_size);
+            if (name == ".text") text_header = section_header, text_position = code.size();
+            if (name == ".symtab") symtab_header = section_header;
+            if (name == ".strtab") strtab_header = section_header;
+            if (section_header.sh_type == 0x70000003) arch = find_riscv_arch(image.view<uint8_t>(section_header.sh_offset, section_header.sh_size), section_header.sh_size);   // SHT_RISCV_ATTRIBUTES
+            // SHF_EXECINSTR, with contents (not SHT_NOBITS); .text itself is added below.
+            if ((section_header.sh_flags & 0x4) != 0 && section_header.sh_type != 8 && section_header.sh_size != 0 && name != ".text") {
+                code.push_back({section_header, image.view<uint8_t>(section_header.sh_offset, section_header.sh_size), name});
+            }
+        }
+    }
+
+    Basic_Sections<ELF> sections{};
+    sections.text_header = text_header;
+    sections.symtab_header = symtab_header;
+    sections.strtab_header = strtab_header;
+    sections.strtab = image.view<uint8_t>(strtab_header.sh_offset, strtab_header.sh_size);
+    sections.symbols_count = symtab_header.sh_size / sizeof(typename ELF::Symbol);
+    sections.symbols = image.view<typename ELF::Symbol>(symtab_header.sh_offset, sections.symbols_count);
+    sections.text = image.view<uint8_t>(text_header.sh_offset, text_header.sh_size);
+    code.insert(code.begin() + text_position, {text_header, sections.text, ".text"});
+    std::stable_sort(code.begin(), code.end(), [](const Code_Section<ELF> &a, const Code_Section<ELF> &b) {
+        return a.header.sh_addr < b.header.sh_addr;
+    });
+    sections.code = std::move(code);
+    sections.extensions = select_extensions(file_header.e_flags, arch);
+    return sections;
+}
+
+// A piece [begin, end) of the bytes of code section `section`, handled as one work item.
+struct Code_Chunk {
+    size_t section;
+    size_t begin, end;
+};
+
+// Splits the code sections into work items in address order. Every section is an item of its own, and with jobs > 1
+// one larger than a quarter of a thread's fair share is cut into chunks on instruction boundaries, so that a few big
+// sections among many small ones still keep all threads busy.
+template<typename ELF>
+std::vector<Code_Chunk> split_code(const std::vector<Code_Section<ELF>> &code, size_t jobs) {
+    uint64_t total = 0;
+    for (const Code_Section<ELF> &section : code) total += section.header.sh_size;
+    uint64_t share = std::max<uint64_t>(1, total / (jobs * 4));
+    std::vector<Code_Chunk> chunks;
+    for (size_t i = 0; i < code.size(); i++) {
+        size_t size = code[i].header.sh_size, count = (jobs == 1 ? 1 : (size + share - 1) / share);
+        if (count <= 1) {
+            chunks.push_back({i, 0, size});
+            continue;
+        }
+        std::vector<size_t> starts = split_text(code[i].data, size, count, jobs);
+        for (size_t k = 0; k + 1 < starts.size(); k++) chunks.push_back({i, starts[k], starts[k + 1]});
+    }
+    return chunks;
+}
+
+// The code sections (see Basic_Sections) are split into work items. A first pass collects jump and branch targets, then
+// the labels are resolved and a second pass prints, so no label is ever patched in after its line is written. By
+// default both passes decode the item: the first decodes only the jump candidates the prescan finds, and decoding is a
+// small part of printing, so filling a buffer costs more than it saves. With single_pass every item is decoded once
+// into a Basic_Insn buffer, which the print pass reads instead of the input; the columnar format needs that, as it is
+// written column by column, and streaming turns it off. With jobs > 1 the items are handled by a work-stealing pool of
+// threads and their listings are concatenated in address order, so the output depends neither on jobs nor on
+// single_pass; every section is headed by its name in the text listing. With streaming, both passes walk the code in
+// ELF_Image::window_size windows of the staged input (see ELF_Image::spool) and drop every finished window from memory;
+// the output is flushed every Output_Buffer block. Everything is instantiated per ELF class, so RV64 code is decoded
+// and printed without checking the width on every instruction.
+template<typename ELF>
+void disasm_elf(const ELF_Image &image, FILE *output_file, const Disasm_Options &options, Disasm_Context &context, Disasm_Buffers<ELF> &buffers) {
+    using Address = typename ELF::Address;
+    Disasm_Stats *stats = (stats_enabled ? options.stats : nullptr);
+    Stage_Clock clock(stats);
+    Basic_Sections<ELF> sections = find_elf_sections<ELF>(image);
+    const std::vector<Code_Section<ELF>> &code = sections.code;
+    size_t jobs = std::max<size_t>(1, options.jobs);
+    std::vector<Code_Chunk> chunks = split_code(code, jobs);
+    size_t workers = std::min(jobs, chunks.size());
+    // The columnar format is written column by column, so it needs the whole of the code decoded first.
+    bool single_pass = options.single_pass || options.format == FORMAT_COLUMNAR;
+    auto window = [&options](const Code_Section<ELF> &section) {
+        return (options.streaming ? ELF_Image::window_size : section.header.sh_size);
+    };
+    // Every worker counts instructions into its own Disasm_Stats, added to `stats` at the end.
+    std::vector<Disasm_Stats> &worker_stats = context.worker_stats;
+    if (stats != nullptr) worker_stats.assign(workers, Disasm_Stats());
+    auto stats_of = [&](size_t worker) {
+        return (stats != nullptr ? &worker_stats[worker] : nullptr);
+    };
+    clock.lap(STAGE_PARSE);
+
+    std::vector<std::vector<Basic_Insn<Address>>> &chunk_insns = buffers.chunk_insns;
+    std::vector<std::vector<Address>> &chunk_targets = buffers.chunk_targets;
+    chunk_insns.resize(std::max(chunk_insns.size(), chunks.size()));
+    chunk_targets.resize(std::max(chunk_targets.size(), chunks.size()));
+    run_stealing(chunks.size(), workers, [&](size_t k, size_t worker) {
+        const Code_Chunk &chunk = chunks[k];
+        const Code_Section<ELF> &section = code[chunk.section];
+        const typename ELF::Section_Header &header = section.header;
+        chunk_insns[k].clear();
+        chunk_targets[k].clear();
+        if (!single_pass) {
+            for_windows(image, header.sh_offset, chunk.begin, chunk.end, window(section), options.streaming, [&](size_t from, size_t to) {
+                return collect_targets<ELF>(section.data, from, to, header.sh_size, header.sh_addr, chunk_targets[k]);
+            });
+            return;
+        }
+        size_t length = chunk.end - chunk.begin;
+        chunk_insns[k].reserve(length / 2);
+        if (decode_range<ELF>(section.data + chunk.begin, length, header.sh_addr + chunk.begin, chunk_insns[k], sections.extensions) != length) throw FileFormatException("An error occurred while reading!");
+        for (const Basic_Insn<Address> &insn : chunk_insns[k]) {
+            if (insn.has_target) chunk_targets[k].push_back(insn.target);
+            if (stats_enabled && stats != nullptr) worker_stats[worker].count<ELF::xlen>(section.data + (insn.address - header.sh_addr), insn.mnemonic);
+        }
+    });
+    std::vector<Address> &targets = buffers.targets;
+    targets.clear();
+    // A single item (one code section under streaming) hands its targets over instead of holding a second copy of them.
+    if (chunks.size() == 1) targets.swap(chunk_targets[0]);
+    for (size_t k = 0; k < chunks.size(); k++) targets.insert(targets.end(), chunk_targets[k].begin(), chunk_targets[k].end());
+    clock.lap(STAGE_LABELS);
+
+    // The "no label here" bitmap covers the largest section; labels elsewhere are found by binary search alone.
+    const Code_Section<ELF> *largest = &code.front();
+    for (const Code_Section<ELF> &section : code) {
+        if (section.header.sh_size > largest->header.sh_size) largest = &section;
+    }
+    Basic_Label_Index<Address> &labels = buffers.labels;
+    labels.build(sections.symbols, sections.symbols_count, sections.strtab, sections.strtab_header.sh_size, targets, largest->header.sh_addr, largest->header.sh_size);
+    clock.lap(STAGE_SYMBOLS);
+
+    Output_Buffer &output = context.output;
+    output.set_file(output_file);
+#ifdef LAB3_STATS
+    uint64_t written_bytes = output.written_bytes;
+    double write_seconds = output.write_seconds;
+#endif
+    // Ends the print stage once the output is flushed; what went to fwrite meanwhile is the write stage.
+    auto finish = [&]() {
+        output.set_file(nullptr);
+#ifdef LAB3_STATS
+        if (stats == nullptr) return;
+        write_seconds = output.write_seconds - write_seconds;
+        clock.lap(STAGE_PRINT, write_seconds);
+        stats->seconds[STAGE_WRITE] += write_seconds;
+        stats->bytes_written += output.written_bytes - written_bytes;
+        stats->files++;
+        for (const Disasm_Stats &counts : worker_stats) stats->add(counts);
+#endif
+    };
+    if (options.format == FORMAT_COLUMNAR) {
+        print_columnar(sections, chunk_insns, chunks.size(), labels, output);
+        finish();
+        return;
+    }
+
+    auto print_chunk = [&](size_t k, size_t worker, Output_Buffer &chunk_output) {
+        const Code_Chunk &chunk = chunks[k];
+        const Code_Section<ELF> &section = code[chunk.section];
+        const typename ELF::Section_Header &header = section.header;
+        if (single_pass) {
+            print_text(chunk_insns[k], labels, options.format, chunk_output);
+        } else {
+            for_windows(image, header.sh_offset, chunk.begin, chunk.end, window(section), options.streaming, [&](size_t from, size_t to) {
+                return print_text<ELF>(section.data, from, to, header.sh_size, header.sh_addr, labels, sections.extensions, options.format, chunk_output, stats_of(worker));
+            });
+        }
+    };
+    // The text listing names every section before its first item, the way it names .symtab.
+    auto put_section_name = [&](size_t k) {
+        if (options.format != FORMAT_TEXT || (k > 0 && chunks[k - 1].section == chunks[k].section)) return;
+        if (k > 0) output.write("\n");
+        output.write(code[chunks[k].section].name);
+        output.write("\n");
+    };
+    if (workers == 1) {
+        for (size_t k = 0; k < chunks.size(); k++) {
+            put_section_name(k);
+            print_chunk(k, 0, output);
+        }
+    } else {
+        std::vector<std::unique_ptr<Output_Buffer>> &chunk_outputs = context.chunk_outputs;
+        while (chunk_outputs.size() < chunks.size()) chunk_outputs.push_back(std::make_unique<Output_Buffer>(nullptr, 1 << 16));
+        run_stealing(chunks.size(), workers, [&](size_t k, size_t worker) {
+            chunk_outputs[k]->clear();
+            print_chunk(k, worker, *chunk_outputs[k]);
+        });
+        for (size_t k = 0; k < chunks.size(); k++) {
+            put_section_name(k);
+            output.write(chunk_outputs[k]->view());
+        }
+    }
+
+    print_symtab(sections, labels, options.format, output);
+    finish();
+}
+
+} // namespace
+
+template<typename ELF>
+Basic_Sections<ELF> find_sections(const ELF_Image &image) {
+    if (is_elf64(image) != (ELF::xlen == 64)) throw FileFormatException("Wrong ELF class of input file!");
+    return find_elf_sections<ELF>(image);
+}
+
+template Basic_Sections<ELF32> find_sections<ELF32>(const ELF_Image &image);
+template Basic_Sections<ELF64> find_sections<ELF64>(const ELF_Image &image);
+
+template<typename ELF>
+Disasm_Buffers<ELF>::Disasm_Buffers() = default;
+
+template<typename ELF>
+Disasm_Buffers<ELF>::~Disasm_Buffers() = default;
+
+template struct Disasm_Buffers<ELF32>;
+template struct Disasm_Buffers<ELF64>;
+
+Disasm_Context::Disasm_Context() = default;
+
+Disasm_Context::~Disasm_Context() = default;
+
+void disasm(const ELF_Image &image, FILE *output_file, const Disasm_Options &options, Disasm_Context &context) {
+    if (is_elf64(image)) disasm_elf<ELF64>(image, output_file, options, context, context.rv64);
+    else disasm_elf<ELF32>(image, output_file, options, context, context.rv32);
+}
+
+template<typename ELF>
+void Basic_Disassembler<ELF>::index() {
+    index_image.unload();
+    sections = find_sections<ELF>(image);
+    std::vector<Address> targets;
+    checkpoints.clear();
+    for (size_t cur = 0; cur < text_size();) {
+        if (cur >= checkpoints.size() * checkpoint_step) checkpoints.push_back(cur);
+        cur = collect_targets<ELF>(sections.text, cur, std::min<size_t>(text_size(), checkpoints.size() * checkpoint_step), text_size(), text_address(), targets);
+    }
+    checkpoint_table = checkpoints.data();
+    checkpoint_count = checkpoints.size();
+    // Jumps from the other code sections get their labels too, as in disasm(); only .text has checkpoints.
+    for (const Code_Section<ELF> &section : sections.code) {
+        if (section.data != sections.text) collect_targets<ELF>(section.data, 0, section.header.sh_size, section.header.sh_size, section.header.sh_addr, targets);
+    }
+    labels.build(sections.symbols, sections.symbols_count, sections.strtab, sections.strtab_header.sh_size, targets, text_address(), text_size());
+    symbol_index.build(sections.symbols, sections.symbols_count, sections.strtab, sections.strtab_header.sh_size, text_address() + text_size());
+}
+
+// Maps the tables from the index at index_path if it was built from `file` (whose elf_size, and with `has_identity`
+// the stat fields, are filled in). Sets `hashed` if it had to hash the ELF file, which is then in file.elf_hash.
+template<typename ELF>
+bool Basic_Disassembler<ELF>::attach_index(const char *index_path, Index_File_Header &file, bool has_identity, bool &hashed) {
+    try {
+        index_image.load(index_path);
+        const Index_File_Header &header = *index_image.view<Index_File_Header>(0);
+        if (memcmp(header.magic, index_file_magic, sizeof header.magic) != 0 || header.version != index_file_version || header.checkpoint_step != checkpoint_step) return false;
+        if (header.elf_size != file.elf_size) return false;
+        if (!has_identity || header.elf_mtime_ns != file.elf_mtime_ns || header.elf_inode != file.elf_inode || header.elf_device != file.elf_device) {
+            file.elf_hash = content_hash(image.data(), image.size());
+            hashed = true;
+            if (header.elf_hash != file.elf_hash) return false;
+        }
+        file.elf_hash = header.elf_hash;
+
+        Address text_end = text_address() + text_size();
+        if (text_end < text_address()) text_end = std::numeric_limits<Address>::max();
+        if (header.text_begin != text_address() || header.text_end != text_end) return false;
+        if (header.text_bits_count != ((uint64_t)(text_end - text_address()) / 2 + 63) / 64) return false;
+        if ((text_size() != 0) != (header.checkpoints_count != 0) || header.checkpoints_count > text_size() / checkpoint_step + 1) return false;
+        labels.attach({index_image.view<typename Basic_Label_Index<Address>::Entry>(header.entries_offset, header.entries_count), header.entries_count,
+                       index_image.view<char>(header.arena_offset, header.arena_size), header.arena_size,
+                       index_image.view<uint64_t>(header.text_bits_offset, header.text_bits_count), header.text_bits_count,
+                       (Address)header.text_begin, (Address)header.text_end});
+        symbol_index.attach({index_image.view<typename Basic_Symbol_Index<Address>::Interval>(header.intervals_offset, header.intervals_count),
+                             index_image.view<Address>(header.max_end_offset, header.intervals_count),
+                             index_image.view<uint32_t>(header.by_name_offset, header.intervals_count), header.intervals_count},
+                            sections.strtab);
+        checkpoints.clear();
+        checkpoint_table = index_image.view<Address>(header.checkpoints_offset, header.checkpoints_count);
+        checkpoint_count = header.checkpoints_count;
+        return true;
+    } catch (FileNotFoundException &) {
+        return false;
+    } catch (FileFormatException &) {
+        return false;
+    }
+}
+
+// Writes the current tables to index_path through a temporary file, so a reader never maps a half-written index.
+// The index is only a cache: if it cannot be written, it is not.
+template<typename ELF>
+void Basic_Disassembler<ELF>::save_index(const char *index_path, const Index_File_Header &file) const {
+    std::string temp_path = std::string(index_path) + ".XXXXXX";
+    int fd = mkstemp(temp_path.data());
+    if (fd < 0) return;
+    fchmod(fd, 0644);
+    FILE *temp = fdopen(fd, "wb");
+    if (temp == nullptr) {
+        close(fd);
+        unlink(temp_path.c_str());
+        return;
+    }
+
+    Index_File_Header header = file;
+    memcpy(header.magic, index_file_magic, sizeof header.magic);
+    header.version = index_file_version;
+    header.checkpoint_step = checkpoint_step;
+    const typename Basic_Label_Index<Address>::Tables &label_tables = labels.tables();
+    const typename Basic_Symbol_Index<Address>::Tables &symbol_tables = symbol_index.tables();
+    header.text_begin = label_tables.text_begin;
+    header.text_end = label_tables.text_end;
+    uint64_t end = sizeof header;
+    auto place = [&end](uint64_t size) {
+        uint64_t offset = end;
+        end = (end + size + 7) / 8 * 8;
+        return offset;
+    };
+    header.entries_offset = place(label_tables.entries_count * sizeof(typename Basic_Label_Index<Address>::Entry));
+    header.entries_count = label_tables.entries_count;
+    header.arena_offset = place(label_tables.arena_size);
+    header.arena_size = label_tables.arena_size;
+    header.text_bits_offset = place(label_tables.text_bits_count * sizeof(uint64_t));
+    header.text_bits_count = label_tables.text_bits_count;
+    header.checkpoints_offset = place(checkpoint_count * sizeof(Address));
+    header.checkpoints_count = checkpoint_count;
+    header.intervals_offset = place(symbol_tables.count * sizeof(typename Basic_Symbol_Index<Address>::Interval));
+    header.max_end_offset = place(symbol_tables.count * sizeof(Address));
+    header.by_name_offset = place(symbol_tables.count * sizeof(uint32_t));
+    header.intervals_count = symbol_tables.count;
+
+    bool ok = true;
+    uint64_t written = 0;
+    auto put = [&](uint64_t offset, const void *data, uint64_t size) {
+        static const char zeros[8] = {};
+        if (offset > written) ok = ok && fwrite(zeros, 1, offset - written, temp) == offset - written;
+        ok = ok && (size == 0 || fwrite(data, 1, size, temp) == size);
+        written = offset + size;
+    };
+    put(0, &header, sizeof header);
+    put(header.entries_offset, label_tables.entries, label_tables.entries_count * sizeof(typename Basic_Label_Index<Address>::Entry));
+    put(header.arena_offset, label_tables.arena, label_tables.arena_size);
+    put(header.text_bits_offset, label_tables.text_bits, label_tables.text_bits_count * sizeof(uint64_t));
+    put(header.checkpoints_offset, checkpoint_table, checkpoint_count * sizeof(Address));
+    put(header.intervals_offset, symbol_tables.intervals, symbol_tables.count * sizeof(typename Basic_Symbol_Index<Address>::Interval));
+    put(header.max_end_offset, symbol_tables.max_end, symbol_tables.count * sizeof(Address));
+    put(header.by_name_offset, symbol_tables.by_name, symbol_tables.count * sizeof(uint32_t));
+    ok = (fclose(temp) == 0) && ok;
+    if (!ok || rename(temp_path.c_str(), index_path) != 0) unlink(temp_path.c_str());
+}
+
+template<typename ELF>
+void Basic_Disassembler<ELF>::open(const uint8_t *data, size_t size) {
+    image.assign(data, size);
+    index();
+}
+
+template<typename ELF>
+void Basic_Disassembler<ELF>::open(const char *path) {
+    image.load(path);
+    index();
+}
+
+template<typename ELF>
+bool Basic_Disassembler<ELF>::open(const char *path, const char *index_path) {
+    // stat() before the file is read: if it changes in between, the next run sees other stat fields and rehashes.
+    Index_File_Header file{};
+    bool has_identity = file_identity(path, file.elf_mtime_ns, file.elf_inode, file.elf_device);
+    image.load(path);
+    return open_index(index_path, file, has_identity);
+}
+
+// The rest of open(path, index_path) once the file is loaded into `image`.
+template<typename ELF>
+bool Basic_Disassembler<ELF>::open_index(const char *index_path, Index_File_Header &file, bool has_identity) {
+    sections = find_sections<ELF>(image);
+    file.elf_size = image.size();
+    bool hashed = false;
+    if (attach_index(index_path, file, has_identity, hashed)) {
+        // Only the stat fields were out of date (the file was touched or copied): record the new ones.
+        if (hashed && has_identity) save_index(index_path, file);
+        return true;
+    }
+    index();
+    if (!hashed) file.elf_hash = content_hash(image.data(), image.size());
+    save_index(index_path, file);
+    return false;
+}
+
+template<typename ELF>
+size_t Basic_Disassembler<ELF>::offset_of(Address address) const {
+    if (!contains(address)) throw std::out_of_range("Address outside .text!");
+    return address - text_address();
+}
+
+template<typename ELF>
+typename ELF::Address Basic_Disassembler<ELF>::boundary_before(Address address) const {
+    size_t offset = offset_of(address), i = std::min<size_t>(offset / checkpoint_step, checkpoint_count - 1);
+    size_t cur = checkpoint_table[i];
+    if (cur > offset) cur = checkpoint_table[i - 1];
+    if (cur >= text_size()) throw FileFormatException("An error occurred while reading!");
+    for (size_t next = next_boundary(sections.text, cur); next <= offset; next = next_boundary(sections.text, cur)) cur = next;
+    return text_address() + cur;
+}
+
+template<typename ELF>
+Basic_Insn<typename ELF::Address> Basic_Disassembler<ELF>::decode(Address address) const {
+    size_t offset = offset_of(address);
+    check_insn(sections.text, offset, text_size());
+    return decode_insn<ELF>(sections.text + offset, address, sections.extensions);
+}
+
+template<typename ELF>
+size_t Basic_Disassembler<ELF>::end_offset(Address end) const {
+    if (end <= text_address()) return 0;
+    return std::min<size_t>(text_size(), end - text_address());
+}
+
+template<typename ELF>
+typename ELF::Address Basic_Disassembler<ELF>::decode_range(Address begin, Address end, std::vector<Basic_Insn<Address>> &insns) const {
+    size_t cur = offset_of(begin), to = end_offset(end);
+    while (cur < to) {
+        check_insn(sections.text, cur, text_size());
+        insns.push_back(decode_insn<ELF>(sections.text + cur, text_address() + cur, sections.extensions));
+        cur += insns.back().length;
+    }
+    return text_address() + cur;
+}
+
+template<typename ELF>
+typename ELF::Address Basic_Disassembler<ELF>::print_range(Address begin, Address end, Output_Buffer &output, Output_Format format) const {
+    if (format == FORMAT_COLUMNAR) throw std::invalid_argument("Invalid output format!");
+    return text_address() + print_text<ELF>(sections.text, offset_of(begin), end_offset(end), text_size(), text_address(), labels, sections.extensions, format, output);
+}
+
+template<typename ELF>
+void Basic_Disassembler<ELF>::print_listing(Output_Buffer &output, Output_Format format) const {
+    if (format == FORMAT_COLUMNAR) throw std::invalid_argument("Invalid output format!");
+    for (size_t i = 0; i < sections.code.size(); i++) {
+        const typename ELF::Section_Header &header = sections.code[i].header;
+        if (format == FORMAT_TEXT) {
+            if (i > 0) output.write("\n");
+            output.write(sections.code[i].name);
+            output.write("\n");
+        }
+        print_text<ELF>(sections.code[i].data, 0, header.sh_size, header.sh_size, header.sh_addr, labels, sections.extensions, format, output);
+    }
+    print_symtab(sections, labels, format, output);
+}
+
+template<typename ELF>
+void Basic_Disassembler<ELF>::flow_graph(Basic_Flow_Graph<ELF> &graph) const {
+    graph.build(sections.text, text_address(), text_size(), symbol_index, sections.symbols);
+}
+
+template<typename ELF>
+void Basic_Disassembler<ELF>::print_flow_graph(const Basic_Flow_Graph<ELF> &graph, Output_Buffer &output, Graph_Format format) const {
+    if (format == GRAPH_DOT) print_dot(sections, graph, labels, output);
+    else print_graph_binary(sections, graph, output);
+}
+
+template class Basic_Disassembler<ELF32>;
+template class Basic_Disassembler<ELF64>;
+
+void Any_Disassembler::pick_class() {
+    elf64 = is_elf64(rv32.image);
+    if (!elf64) return;
+    rv64.image.swap(rv32.image);
+    rv32.image.unload();
+}
+
+void Any_Disassembler::open(const char *path) {
+    rv32.image.load(path);
+    pick_class();
+    if (elf64) rv64.index();
+    else rv32.index();
+}
+
+bool Any_Disassembler::open(const char *path, const char *index_path) {
+    // stat() before the file is read, as in Basic_Disassembler::open().
+    Index_File_Header file{};
+    bool has_identity = file_identity(path, file.elf_mtime_ns, file.elf_inode, file.elf_device);
+    rv32.image.load(path);
+    pick_class();
+    return (elf64 ? rv64.open_index(index_path, file, has_identity) : rv32.open_index(index_path, file, has_identity));
+}
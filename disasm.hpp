@@ -0,0 +1,216 @@
+#ifndef LAB3_DISASM_HPP
+#define LAB3_DISASM_HPP
+
+#include "elf.hpp"
+#include "insn.hpp"
+#include "labels.hpp"
+#include "output.hpp"
+#include "symbols.hpp"
+
+#include <cstdio>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+template<typename ELF>
+class Basic_Flow_Graph;
+struct Disasm_Stats;
+struct Index_File_Header;
+
+// A section of code: its header, its bytes in the image and its name.
+template<typename ELF>
+struct Code_Section {
+    typename ELF::Section_Header header;
+    const uint8_t *data;
+    std::string_view name;
+};
+
+// .text, .symtab and .strtab of an ELF file of class ELF (ELF32 or ELF64); every pointer is a view into the image,
+// checked against its length. `code` is what the listing covers: .text (even if there is none, as an empty section)
+// and every other non-empty SHF_EXECINSTR section with contents, ordered by address and then by section index.
+// `extensions` are the Extension bits to decode, chosen from e_flags and .riscv.attributes by select_extensions().
+template<typename ELF>
+struct Basic_Sections {
+    typename ELF::Section_Header text_header, symtab_header, strtab_header;
+    const uint8_t *text;
+    const typename ELF::Symbol *symbols;
+    size_t symbols_count;
+    const uint8_t *strtab;
+    std::vector<Code_Section<ELF>> code;
+    uint32_t extensions;
+};
+
+using ELF_Sections = Basic_Sections<ELF32>;
+
+// The sections of an ELF file of class ELF; throws FileFormatException if the file is of the other class.
+template<typename ELF = ELF32>
+Basic_Sections<ELF> find_sections(const ELF_Image &image);
+
+enum Output_Format {
+    FORMAT_TEXT,       // the listing
+    FORMAT_COLUMNAR,   // columns of decoded fields, see columnar.hpp
+    FORMAT_JSONL,      // one JSON object per instruction and per .symtab row
+};
+
+enum Graph_Format {
+    GRAPH_DOT,      // Graphviz digraph, one cluster per function
+    GRAPH_BINARY,   // the arrays of the graph, see Flow_Graph_Header in cfg.hpp
+};
+
+struct Disasm_Options {
+    size_t jobs = 1;
+    bool single_pass = false;
+    bool streaming = false;
+    Output_Format format = FORMAT_TEXT;
+    Disasm_Stats *stats = nullptr;   // adds up the --stats counters and timers of every call if not nullptr, see stats.hpp
+};
+
+// The buffers of Disasm_Context that depend on the ELF class.
+template<typename ELF>
+struct Disasm_Buffers {
+    std::vector<std::vector<Basic_Insn<typename ELF::Address>>> chunk_insns;
+    std::vector<std::vector<typename ELF::Address>> chunk_targets;
+    std::vector<typename ELF::Address> targets;
+    Basic_Label_Index<typename ELF::Address> labels;
+
+    Disasm_Buffers();
+    ~Disasm_Buffers();
+};
+
+// Buffers reused by disasm() between the files handled by one thread, so a long batch does not reallocate them.
+struct Disasm_Context {
+    Disasm_Buffers<ELF32> rv32;
+    Disasm_Buffers<ELF64> rv64;
+    std::vector<std::unique_ptr<Output_Buffer>> chunk_outputs;
+    std::vector<Disasm_Stats> worker_stats;
+    Output_Buffer output{nullptr};
+
+    Disasm_Context();
+    ~Disasm_Context();
+};
+
+// Writes the .text and .symtab listing of the image to output_file, or keeps it in context.output if that is nullptr.
+// ELF32 files are listed as RV32 code, ELF64 files as RV64 code with 16-digit addresses.
+void disasm(const ELF_Image &image, FILE *output_file, const Disasm_Options &options, Disasm_Context &context);
+
+// Disassembler over one ELF image in memory, for use as a library. open() parses the sections and builds the label
+// index once; every query after that is const and touches no shared or global state, so one Disassembler can serve
+// several threads, and separate Disassemblers are fully independent. Addresses outside .text throw std::out_of_range,
+// a malformed image throws FileFormatException, and so does an image of the other ELF class: Disassembler reads
+// ELF32 files as RV32 code, Disassembler64 ELF64 files as RV64 code, and Any_Disassembler takes either.
+template<typename ELF>
+class Basic_Disassembler {
+public:
+    using ELF_Class = ELF;
+    using Address = typename ELF::Address;
+
+private:
+    ELF_Image image;
+    ELF_Image index_image;   // the index file, when the tables below are mapped from it
+    Basic_Sections<ELF> sections{};
+    Basic_Label_Index<Address> labels;
+    Basic_Symbol_Index<Address> symbol_index;
+    std::vector<Address> checkpoints;
+    const Address *checkpoint_table = nullptr;   // checkpoint_table[i]: offset of the first instruction at or after i * checkpoint_step
+    size_t checkpoint_count = 0;
+
+    void index();
+    bool open_index(const char *index_path, Index_File_Header &file, bool has_identity);
+    bool attach_index(const char *index_path, Index_File_Header &file, bool has_identity, bool &hashed);
+    void save_index(const char *index_path, const Index_File_Header &file) const;
+    size_t offset_of(Address address) const;
+    size_t end_offset(Address end) const;
+
+    friend class Any_Disassembler;
+
+public:
+    static const uint32_t checkpoint_step = 256;
+
+    Basic_Disassembler() = default;
+
+    // Borrows `size` bytes at `data`; they must stay valid until the next open() or the Disassembler is destroyed.
+    void open(const uint8_t *data, size_t size);
+
+    // Maps (or reads) the file at `path`.
+    void open(const char *path);
+
+    // The same, with the label, symbol and checkpoint tables kept in the index file at `index_path`: if it was built
+    // from this ELF file, they are mapped from it and .text is not decoded; otherwise they are built and the index
+    // is (re)written. A changed ELF file is detected by its size and content hash; when its size, mtime and inode are
+    // the ones recorded in the index, the hash is not recomputed. Returns true if the existing index was used.
+    bool open(const char *path, const char *index_path);
+
+    Address text_address() const {
+        return sections.text_header.sh_addr;
+    }
+
+    Address text_size() const {
+        return sections.text_header.sh_size;
+    }
+
+    bool contains(Address address) const {
+        return address >= text_address() && address - text_address() < text_size();
+    }
+
+    // Label at `address` (a symbol name or LOC_xxxxx), or an empty string.
+    std::string_view label(Address address) const {
+        return labels.find(address);
+    }
+
+    const Basic_Symbol_Index<Address> &symbols() const {
+        return symbol_index;
+    }
+
+    // Start of the instruction that covers `address`. .text is decoded from the nearest checkpoint at most
+    // checkpoint_step bytes before it, so this works for any address in mixed 16/32-bit code.
+    Address boundary_before(Address address) const;
+
+    // The instruction at `address`, which must be where an instruction starts.
+    Basic_Insn<Address> decode(Address address) const;
+
+    // Appends the instructions that start in [begin, end) to `insns`; begin must be where an instruction starts.
+    // Returns the address following the last one.
+    Address decode_range(Address begin, Address end, std::vector<Basic_Insn<Address>> &insns) const;
+
+    // Writes the listing lines of the instructions that start in [begin, end), as in the .text listing, or their
+    // JSON objects with FORMAT_JSONL. Returns the address following the last one.
+    Address print_range(Address begin, Address end, Output_Buffer &output, Output_Format format = FORMAT_TEXT) const;
+
+    // Writes the whole listing of every code section, the same that disasm() writes in FORMAT_TEXT or FORMAT_JSONL.
+    void print_listing(Output_Buffer &output, Output_Format format = FORMAT_TEXT) const;
+
+    // Builds the basic blocks and control-flow edges of every function symbol into `graph`, see cfg.hpp.
+    void flow_graph(Basic_Flow_Graph<ELF> &graph) const;
+
+    // Writes a graph built by flow_graph(); blocks are named by their labels, functions by their symbols.
+    void print_flow_graph(const Basic_Flow_Graph<ELF> &graph, Output_Buffer &output, Graph_Format format) const;
+};
+
+using Disassembler = Basic_Disassembler<ELF32>;
+using Disassembler64 = Basic_Disassembler<ELF64>;
+
+// The Basic_Disassembler of whichever class a file turns out to be, for callers that take both: open() reads the file
+// once and parses it by its EI_CLASS, and visit(f) calls f with the Disassembler or the Disassembler64, so `f` is
+// usually a generic lambda.
+class Any_Disassembler {
+private:
+    Disassembler rv32;
+    Disassembler64 rv64;
+    bool elf64 = false;
+
+    // Moves the file just loaded into rv32 over to rv64 if it is an ELF64 one.
+    void pick_class();
+
+public:
+    // See Basic_Disassembler::open().
+    void open(const char *path);
+    bool open(const char *path, const char *index_path);
+
+    template<typename F>
+    decltype(auto) visit(F &&f) const {
+        if (elf64) return f(rv64);
+        return f(rv32);
+    }
+};
+
+#endif //LAB3_DISASM_HPP
@@ -0,0 +1,314 @@
+#ifndef LAB3_ELF_HPP
+#define LAB3_ELF_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class FileNotFoundException : public std::exception {
+private:
+    std::string error;
+public:
+    explicit FileNotFoundException(std::string err) : error(std::move(err)) {}
+    const char * what() const noexcept override {
+        return error.c_str();
+    }
+};
+
+class FileFormatException : public std::exception {
+private:
+    std::string error;
+public:
+    explicit FileFormatException(std::string err) : error(std::move(err)) {}
+    const char * what() const noexcept override {
+        return error.c_str();
+    }
+};
+
+#pragma pack(push, 1)
+
+struct ELF32_File_Header {
+    uint8_t e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint32_t e_entry;
+    uint32_t e_phoff;
+    uint32_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+};
+
+struct ELF32_Section_Header {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint32_t sh_flags;
+    uint32_t sh_addr;
+    uint32_t sh_offset;
+    uint32_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint32_t sh_addralign;
+    uint32_t sh_entsize;
+};
+
+struct ELF32_Symbol {
+    uint32_t st_name;
+    uint32_t st_value;
+    uint32_t st_size;
+    uint8_t st_info;
+    uint8_t st_other;
+    uint16_t st_shndx;
+};
+
+struct ELF64_File_Header {
+    uint8_t e_ident[16];
+    uint16_t e_type;
+    uint16_t e_machine;
+    uint32_t e_version;
+    uint64_t e_entry;
+    uint64_t e_phoff;
+    uint64_t e_shoff;
+    uint32_t e_flags;
+    uint16_t e_ehsize;
+    uint16_t e_phentsize;
+    uint16_t e_phnum;
+    uint16_t e_shentsize;
+    uint16_t e_shnum;
+    uint16_t e_shstrndx;
+};
+
+struct ELF64_Section_Header {
+    uint32_t sh_name;
+    uint32_t sh_type;
+    uint64_t sh_flags;
+    uint64_t sh_addr;
+    uint64_t sh_offset;
+    uint64_t sh_size;
+    uint32_t sh_link;
+    uint32_t sh_info;
+    uint64_t sh_addralign;
+    uint64_t sh_entsize;
+};
+
+struct ELF64_Symbol {
+    uint32_t st_name;
+    uint8_t st_info;
+    uint8_t st_other;
+    uint16_t st_shndx;
+    uint64_t st_value;
+    uint64_t st_size;
+};
+
+#pragma pack(pop)
+
+// An ELF class together with the XLEN of the code in it: ELFCLASS32 files hold RV32 code, ELFCLASS64 files RV64.
+// The ELF layer, the decoders and the disassembly passes are templates over one of these, so each width gets its
+// own code with the structure sizes and the address type fixed at compile time.
+struct ELF32 {
+    static const unsigned xlen = 32;
+    using Address = uint32_t;
+    using File_Header = ELF32_File_Header;
+    using Section_Header = ELF32_Section_Header;
+    using Symbol = ELF32_Symbol;
+};
+
+struct ELF64 {
+    static const unsigned xlen = 64;
+    using Address = uint64_t;
+    using File_Header = ELF64_File_Header;
+    using Section_Header = ELF64_Section_Header;
+    using Symbol = ELF64_Symbol;
+};
+
+// Whole input file held in memory: mmap'ed when the input is a regular file,
+// read into a buffer otherwise (pipes, "-" for stdin). Every structure of the
+// file is accessed through bounds-checked views into this single buffer, so no
+// section is ever copied and no size from the headers is trusted before it is
+// checked against the file length. One image can load() file after file; the
+// read buffer keeps its capacity, so a long-running process settles at the
+// size of its largest non-mappable input instead of reallocating per file.
+class ELF_Image {
+private:
+    const uint8_t *bytes = nullptr;
+    size_t length = 0;
+    void *mapping = nullptr;
+    std::vector<uint8_t> buffer;
+
+    void read_all(FILE *file, size_t expected) {
+        size_t used = 0;
+        buffer.resize(std::max<size_t>(buffer.capacity(), std::max<size_t>(expected + 1, 1 << 16)));
+        while (true) {
+            if (used == buffer.size()) buffer.resize(buffer.size() * 2);
+            size_t got = fread(buffer.data() + used, 1, buffer.size() - used, file);
+            if (got == 0) break;
+            used += got;
+        }
+        if (ferror(file)) throw FileFormatException("An error occurred while reading!");
+        bytes = buffer.data();
+        length = used;
+    }
+
+    // Copies the input in window_size blocks to an unlinked temporary file and maps that instead, so a pipe is
+    // never held in process memory. Returns false (nothing consumed) if no temporary file can be created. This stages
+    // the whole input on disk rather than decoding it as it arrives: linkers put .symtab, .strtab and the section
+    // headers after .text, and every listing line needs the symbols, so no line of .text can be printed before the
+    // end of the input anyway.
+    bool spool(FILE *file) {
+        FILE *temp = tmpfile();
+        if (temp == nullptr) return false;
+        buffer.resize(window_size);
+        size_t used = 0, got;
+        while ((got = fread(buffer.data(), 1, window_size, file)) > 0) {
+            if (fwrite(buffer.data(), 1, got, temp) != got) {
+                fclose(temp);
+                throw FileFormatException("An error occurred while reading!");
+            }
+            used += got;
+        }
+        if (ferror(file) || fflush(temp) != 0) {
+            fclose(temp);
+            throw FileFormatException("An error occurred while reading!");
+        }
+        if (used > 0) {
+            void *ptr = mmap(nullptr, used, PROT_READ, MAP_PRIVATE, fileno(temp), 0);
+            if (ptr == MAP_FAILED) {
+                fclose(temp);
+                throw FileFormatException("An error occurred while reading!");
+            }
+            madvise(ptr, used, MADV_SEQUENTIAL);
+            mapping = ptr;
+            bytes = static_cast<const uint8_t *>(ptr);
+            length = used;
+        }
+        fclose(temp);
+        return true;
+    }
+
+public:
+    static const size_t window_size = 1 << 20;
+
+    ELF_Image() = default;
+
+    explicit ELF_Image(const char *path, bool streaming = false) {
+        load(path, streaming);
+    }
+
+    ELF_Image(const ELF_Image &) = delete;
+    ELF_Image &operator=(const ELF_Image &) = delete;
+
+    ~ELF_Image() {
+        unload();
+    }
+
+    // Replaces the current contents with the file at `path`. With `streaming`, an input that cannot be mapped
+    // directly (a pipe, "-" for stdin) is spooled to a temporary file rather than read into memory.
+    void load(const char *path, bool streaming = false) {
+        unload();
+        if (strcmp(path, "-") == 0) {
+            if (!streaming || !spool(stdin)) read_all(stdin, 0);
+            return;
+        }
+        int fd = open(path, O_RDONLY);
+        if (fd < 0) throw FileNotFoundException("Unable to open input file!");
+        struct stat st{};
+        bool regular = (fstat(fd, &st) == 0 && S_ISREG(st.st_mode));
+        if (regular && st.st_size > 0) {
+            void *ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (ptr != MAP_FAILED) {
+                madvise(ptr, st.st_size, MADV_WILLNEED);
+                mapping = ptr;
+                bytes = static_cast<const uint8_t *>(ptr);
+                length = st.st_size;
+                close(fd);
+                return;
+            }
+        }
+        FILE *file = fdopen(fd, "rb");
+        if (file == nullptr) {
+            close(fd);
+            throw FileNotFoundException("Unable to open input file!");
+        }
+        try {
+            if (!streaming || !spool(file)) read_all(file, regular ? st.st_size : 0);
+        } catch (...) {
+            fclose(file);
+            throw;
+        }
+        fclose(file);
+    }
+
+    // Uses `size` bytes at `data` as the file without copying them; they must outlive the image or the next load().
+    void assign(const uint8_t *data, size_t size) {
+        unload();
+        bytes = data;
+        length = size;
+    }
+
+    // Exchanges the files of two images, so one loaded before its ELF class was known can be handed over.
+    void swap(ELF_Image &other) {
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+        std::swap(mapping, other.mapping);
+        buffer.swap(other.buffer);
+    }
+
+    // Hints that [offset, offset + size) will not be read again: the whole pages inside it are dropped from the
+    // mapping and fetched again from the file if they are. A no-op for inputs read into memory.
+    void release(uint64_t offset, uint64_t size) const {
+        if (mapping == nullptr) return;
+        uint64_t page = sysconf(_SC_PAGESIZE);
+        uint64_t begin = (offset + page - 1) / page * page, end = std::min<uint64_t>(offset + size, length) / page * page;
+        if (begin < end) madvise(static_cast<uint8_t *>(mapping) + begin, end - begin, MADV_DONTNEED);
+    }
+
+    // Drops the current file; the read buffer is kept for the next load().
+    void unload() {
+        if (mapping != nullptr) munmap(mapping, length);
+        mapping = nullptr;
+        bytes = nullptr;
+        length = 0;
+    }
+
+    const uint8_t *data() const {
+        return bytes;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    // Pointer to `count` consecutive T's at `offset`, or FileFormatException if they do not fit in the file.
+    template<typename T>
+    const T *view(uint64_t offset, uint64_t count = 1) const {
+        if (offset > length || count > (length - offset) / sizeof(T)) throw FileFormatException("An error occurred while reading!");
+        return reinterpret_cast<const T *>(bytes + offset);
+    }
+};
+
+// True for an ELFCLASS64 file; any other EI_CLASS is read as ELF32, as it always has been.
+inline bool is_elf64(const ELF_Image &image) {
+    return image.view<uint8_t>(0, 16)[4] == 2;
+}
+
+inline uint16_t read_parcel(const uint8_t *ptr) {
+    uint16_t parcel;
+    memcpy(&parcel, ptr, sizeof parcel);
+    return parcel;
+}
+
+#endif //LAB3_ELF_HPP
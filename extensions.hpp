@@ -0,0 +1,171 @@
+#ifndef LAB3_EXTENSIONS_HPP
+#define LAB3_EXTENSIONS_HPP
+
+#include "insn.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+// The standard extensions decoded beyond RV32IMC/RV64IMC, as a bit set. The base ISA, M, C and the privileged
+// instructions are always decoded, the way they always have been.
+enum Extension : uint32_t {
+    EXT_A = 1 << 0,
+    EXT_F = 1 << 1,
+    EXT_D = 1 << 2,
+    EXT_ZICSR = 1 << 3,
+    EXT_ZIFENCEI = 1 << 4,
+    EXT_ZBA = 1 << 5,
+    EXT_ZBB = 1 << 6,
+    EXT_ZBS = 1 << 7
+};
+
+const uint32_t EXT_B = EXT_ZBA | EXT_ZBB | EXT_ZBS;
+
+// Every extension, known or not yet: decoding with it checks nothing.
+const uint32_t EXT_ALL = ~0u;
+
+constexpr std::array<uint32_t, MN_COUNT> make_extension_of() {
+    std::array<uint32_t, MN_COUNT> extensions{};
+    auto set = [&extensions](uint8_t first, uint8_t last, uint32_t extension) {
+        for (uint32_t mnemonic = first; mnemonic <= last; mnemonic++) extensions[mnemonic] = extension;
+    };
+    set(MN_FENCE_I, MN_FENCE_I, EXT_ZIFENCEI);
+    set(MN_CSRRW, MN_CSRRCI, EXT_ZICSR);
+    set(MN_LR_W, MN_AMOMAXU_D, EXT_A);
+    set(MN_FLW, MN_C_FSWSP, EXT_F);
+    set(MN_FLD, MN_C_FSDSP, EXT_D);
+    set(MN_SH1ADD, MN_SLLI_UW, EXT_ZBA);
+    set(MN_ANDN, MN_ZEXT_H, EXT_ZBB);
+    set(MN_BCLR, MN_BSETI, EXT_ZBS);
+    return extensions;
+}
+
+// The extension an instruction belongs to by its mnemonic, 0 for the ones always decoded. Decoders look every
+// encoding up in their own tables regardless of the extensions of the file and check this once at the end, so
+// the cost per instruction does not grow with the number of extensions.
+constexpr std::array<uint32_t, MN_COUNT> extension_of = make_extension_of();
+
+// Extensions named by a Tag_RISCV_arch string such as "rv64i2p1_m2p0_a2p1_f2p2_d2p2_c2p0_zicsr2p0_zba1p0", or
+// EXT_ALL if it does not start with rv32 or rv64. "g" stands for imafd_zicsr_zifencei, and an "i" older than 2.1
+// (or without a version) still includes Zicsr and Zifencei, which were split from it later. Unknown names are skipped.
+inline uint32_t parse_riscv_arch(std::string_view arch) {
+    if (arch.size() < 5 || (arch.substr(0, 4) != "rv32" && arch.substr(0, 4) != "rv64")) return EXT_ALL;
+    uint32_t extensions = 0;
+    size_t cur = 4;
+    auto is_digit = [&arch](size_t i) {
+        return i < arch.size() && arch[i] >= '0' && arch[i] <= '9';
+    };
+    // Skips a version such as "2p1" at cur; returns its major and minor numbers packed as major * 1000 + minor.
+    auto skip_version = [&]() {
+        uint32_t major = 0, minor = 0;
+        while (is_digit(cur)) major = major * 10 + (arch[cur++] - '0');
+        if (cur + 1 < arch.size() && arch[cur] == 'p' && is_digit(cur + 1)) {
+            cur++;
+            while (is_digit(cur)) minor = minor * 10 + (arch[cur++] - '0');
+        }
+        return major * 1000 + minor;
+    };
+
+    // Single-letter extensions, each with an optional version, up to the first multi-letter one.
+    while (cur < arch.size() && arch[cur] != 'z' && arch[cur] != 's' && arch[cur] != 'x') {
+        char letter = arch[cur++];
+        bool versioned = is_digit(cur);
+        uint32_t version = skip_version();
+        switch (letter) {
+            case 'i': case 'e':
+                if (!versioned || version < 2001) extensions |= EXT_ZICSR | EXT_ZIFENCEI;
+                break;
+            case 'g': extensions |= EXT_A | EXT_F | EXT_D | EXT_ZICSR | EXT_ZIFENCEI; break;
+            case 'a': extensions |= EXT_A; break;
+            case 'f': extensions |= EXT_F; break;
+            case 'd': extensions |= EXT_F | EXT_D; break;
+            case 'b': extensions |= EXT_B; break;
+            default: break;
+        }
+        if (cur < arch.size() && arch[cur] == '_') cur++;
+    }
+
+    // Multi-letter extensions, separated by underscores.
+    while (cur < arch.size()) {
+        size_t end = arch.find('_', cur);
+        std::string_view name = arch.substr(cur, end == std::string_view::npos ? std::string_view::npos : end - cur);
+        cur = (end == std::string_view::npos ? arch.size() : end + 1);
+        // Drops the version, such as the "2p0" of "zicsr2p0".
+        auto digit_at = [&name](size_t i) {
+            return i < name.size() && name[i] >= '0' && name[i] <= '9';
+        };
+        while (!name.empty() && (digit_at(name.size() - 1) || (name.back() == 'p' && name.size() >= 2 && digit_at(name.size() - 2)))) name.remove_suffix(1);
+        if (name == "zicsr") extensions |= EXT_ZICSR;
+        else if (name == "zifencei") extensions |= EXT_ZIFENCEI;
+        else if (name == "zaamo" || name == "zalrsc") extensions |= EXT_A;
+        else if (name == "zba") extensions |= EXT_ZBA;
+        else if (name == "zbb") extensions |= EXT_ZBB;
+        else if (name == "zbs") extensions |= EXT_ZBS;
+    }
+    return extensions;
+}
+
+// The Tag_RISCV_arch string of the contents of a .riscv.attributes section, or an empty one if it has none. The
+// section is "A", then subsections of a 32-bit length, a vendor name and sub-subsections of a tag byte and a 32-bit
+// length; only the file-wide (tag 1) attributes of vendor "riscv" are read. An attribute is a ULEB128 tag and a
+// ULEB128 value for even tags or a NUL-terminated string for odd ones. A malformed section reads as having no arch.
+inline std::string_view find_riscv_arch(const uint8_t *data, size_t size) {
+    auto read_u32 = [data](size_t offset) {
+        return (uint32_t)data[offset] | (uint32_t)data[offset + 1] << 8 | (uint32_t)data[offset + 2] << 16 | (uint32_t)data[offset + 3] << 24;
+    };
+    auto read_uleb = [data](size_t &cur, size_t end) {
+        uint64_t value = 0;
+        for (unsigned shift = 0; cur < end; shift += 7) {
+            uint8_t byte = data[cur++];
+            if (shift < 64) value |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) break;
+        }
+        return value;
+    };
+    if (size == 0 || data[0] != 'A') return {};
+    for (size_t subsection = 1; subsection + 4 <= size;) {
+        uint32_t length = read_u32(subsection);
+        if (length < 4 || length > size - subsection) return {};
+        size_t end = subsection + length, cur = subsection + 4;
+        std::string_view rest((const char *)data + cur, end - cur);
+        size_t vendor_end = rest.find('\0');
+        if (vendor_end != std::string_view::npos && rest.substr(0, vendor_end) == "riscv") {
+            cur += vendor_end + 1;
+            while (cur + 5 <= end) {
+                uint8_t tag = data[cur];
+                uint32_t sub_length = read_u32(cur + 1);
+                if (sub_length < 5 || sub_length > end - cur) return {};
+                size_t sub_end = cur + sub_length;
+                for (size_t attribute = cur + 5; tag == 1 && attribute < sub_end;) {
+                    uint64_t attribute_tag = read_uleb(attribute, sub_end);
+                    if (attribute_tag % 2 == 0) {
+                        read_uleb(attribute, sub_end);
+                        continue;
+                    }
+                    std::string_view value((const char *)data + attribute, sub_end - attribute);
+                    size_t value_end = value.find('\0');
+                    if (value_end == std::string_view::npos) return {};
+                    if (attribute_tag == 5) return value.substr(0, value_end);
+                    attribute += value_end + 1;
+                }
+                cur = sub_end;
+            }
+        }
+        subsection = end;
+    }
+    return {};
+}
+
+// The extensions to decode in a file: those of its .riscv.attributes arch string (empty if it has none, which selects
+// every extension, as old toolchains wrote no attributes), plus F or F and D when e_flags says the float ABI passes
+// single or double values in f registers.
+inline uint32_t select_extensions(uint32_t e_flags, std::string_view arch) {
+    uint32_t extensions = (arch.empty() ? EXT_ALL : parse_riscv_arch(arch));
+    uint32_t float_abi = (e_flags >> 1) & 0b11;   // EF_RISCV_FLOAT_ABI: soft, single, double, quad
+    if (float_abi >= 1) extensions |= EXT_F;
+    if (float_abi >= 2) extensions |= EXT_D;
+    return extensions;
+}
+
+#endif //LAB3_EXTENSIONS_HPP
@@ -0,0 +1,310 @@
+#ifndef LAB3_FORMAT_HPP
+#define LAB3_FORMAT_HPP
+
+#include "insn.hpp"
+#include "output.hpp"
+
+#include <string_view>
+
+// Longest operand text apart from the label: "zero, zero, -2147483648".
+const size_t max_operands_length = 32;
+
+// Writes the mnemonic of insn, with the .aq, .rl or .aqrl of lr, sc and the AMOs.
+template<typename Insn>
+inline char *put_mnemonic(char *out, const Insn &insn) {
+    out = put_str(out, mnemonic_names[insn.mnemonic]);
+    if ((insn.operands == OPERANDS_RD_ADDR || insn.operands == OPERANDS_RD_RS2_ADDR) && insn.imm != 0) {
+        constexpr std::string_view suffixes[4] = {"", ".rl", ".aq", ".aqrl"};
+        out = put_str(out, suffixes[insn.imm & 0b11]);
+    }
+    return out;
+}
+
+// Writes a CSR by name, or as a decimal number if it has none in RV32 (or RV64) code.
+inline char *put_csr(char *out, uint32_t csr, bool rv64) {
+    for (const CSR_Name &known : csr_names) {
+        if (known.number == csr && !(rv64 && known.rv32_only)) return put_str(out, known.name);
+    }
+    return put_int(out, csr);
+}
+
+// Writes the pred or succ set of a fence as a subset of "iorw", or "0" if it is empty.
+inline char *put_fence_set(char *out, uint32_t set) {
+    if (set == 0) *out++ = '0';
+    for (int bit = 3; bit >= 0; bit--) {
+        if ((set >> bit) & 1) *out++ = "wroi"[bit];
+    }
+    return out;
+}
+
+inline char *put_rounding_mode(char *out, uint32_t rm) {
+    out = put_str(out, ", ");
+    return put_str(out, rounding_mode_names[rm & 0b111]);
+}
+
+// Writes the operands of insn the way the OPERANDS_* layout says; mark_offset is the label of its target.
+template<typename Insn>
+inline char *put_operands(char *out, const Insn &insn, std::string_view mark_offset) {
+    switch (insn.operands) {
+        case OPERANDS_RD_IMM:
+            out = put_str(out, register_names[insn.rd]);
+            out = put_str(out, ", ");
+            return put_int(out, insn.imm);
+        case OPERANDS_RD_LABEL:
+            out = put_str(out, register_names[insn.rd]);
+            out = put_str(out, ", ");
+            return put_str(out, mark_offset);
+        case OPERANDS_RD_IMM_RS1:
+            out = put_str(out, register_names[insn.rd]);
+            out = put_str(out, ", ");
+            out = put_int(out, insn.imm);
+            *out++ = '(';
+            out = put_str(out, register_names[insn.rs1]);
+            *out++ = ')';
+            return out;
+        case OPERANDS_RD_RS1_IMM:
+            out = put_str(out, register_names[insn.rd]);
+            out = put_str(out, ", ");
+            out = put_str(out, register_names[insn.rs1]);
+            out = put_str(out, ", ");
+            return put_int(out, insn.imm);
+        case OPERANDS_RS1_RS2_LABEL:
+            out = put_str(out, register_names[insn.rs1]);
+            out = put_str(out, ", ");
+            out = put_str(out, register_names[insn.rs2]);
+            out = put_str(out, ", ");
+            return put_str(out, mark_offset);
+        case OPERANDS_RS2_IMM_RS1:
+            out = put_str(out, register_names[insn.rs2]);
+            out = put_str(out, ", ");
+            out = put_int(out, insn.imm);
+            *out++ = '(';
+            out = put_str(out, register_names[insn.rs1]);
+            *out++ = ')';
+            return out;
+        case OPERANDS_RD_RS1_RS2:
+            out = put_str(out, register_names[insn.rd]);
+            out = put_str(out, ", ");
+            out = put_str(out, register_names[insn.rs1]);
+            out = put_str(out, ", ");
+            return put_str(out, register_names[insn.rs2]);
+        case OPERANDS_RD_RS2:
+            out = put_str(out, register_names[insn.rd]);
+            out = put_str(out, ", ");
+            return put_str(out, register_names[insn.rs2]);
+        case OPERANDS_RS1:
+            return put_str(out, register_names[insn.rs1]);
+        case OPERANDS_RS1_LABEL:
+            out = put_str(out, register_names[insn.rs1]);
+            out = put_str(out, ", ");
+            return put_str(out, mark_offset);
+        case OPERANDS_LABEL:
+            return put_str(out, mark_offset);
+        case OPERANDS_FENCE:
+            out = put_fence_set(out, insn.imm >> 4);
+            out = put_str(out, ", ");
+            return put_fence_set(out, insn.imm & 0b1111);
+        case OPERANDS_RD_CSR_RS1:
+        case OPERANDS_RD_CSR_UIMM:
+            out = put_str(out, register_names[insn.rd]);
+            out = put_str(out, ", ");
+            out = put_csr(out, insn.imm, sizeof insn.address == 8);
+            out = put_str(out, ", ");
+            return (insn.operands == OPERANDS_RD_CSR_UIMM ? put_int(out, insn.rs1) : put_str(out, register_names[insn.rs1]));
+        case OPERANDS_RD_ADDR:
+        case OPERANDS_RD_RS2_ADDR:
+            out = put_str(out, register_names[insn.rd]);
+            out = put_str(out, ", ");
+            if (insn.operands == OPERANDS_RD_RS2_ADDR) {
+                out = put_str(out, register_names[insn.rs2]);
+                out = put_str(out, ", ");
+            }
+            *out++ = '(';
+            out = put_str(out, register_names[insn.rs1]);
+            *out++ = ')';
+            return out;
+        case OPERANDS_RD_RS1:
+            out = put_str(out, register_names[insn.rd]);
+            out = put_str(out, ", ");
+            return put_str(out, register_names[insn.rs1]);
+        case OPERANDS_FRD_IMM_RS1:
+        case OPERANDS_FRS2_IMM_RS1:
+            out = put_str(out, float_register_names[insn.operands == OPERANDS_FRD_IMM_RS1 ? insn.rd : insn.rs2]);
+            out = put_str(out, ", ");
+            out = put_int(out, insn.imm);
+            *out++ = '(';
+            out = put_str(out, register_names[insn.rs1]);
+            *out++ = ')';
+            return out;
+        case OPERANDS_FRD_FRS1_FRS2:
+        case OPERANDS_FRD_FRS1_FRS2_RM:
+        case OPERANDS_FRD_FRS1_FRS2_FRS3_RM:
+            out = put_str(out, float_register_names[insn.rd]);
+            out = put_str(out, ", ");
+            out = put_str(out, float_register_names[insn.rs1]);
+            out = put_str(out, ", ");
+            out = put_str(out, float_register_names[insn.rs2]);
+            if (insn.operands == OPERANDS_FRD_FRS1_FRS2) return out;
+            if (insn.operands == OPERANDS_FRD_FRS1_FRS2_FRS3_RM) {
+                out = put_str(out, ", ");
+                out = put_str(out, float_register_names[(insn.imm >> 3) & 0b11111]);
+            }
+            return put_rounding_mode(out, insn.imm);
+        case OPERANDS_FRD_FRS1:
+        case OPERANDS_FRD_FRS1_RM:
+            out = put_str(out, float_register_names[insn.rd]);
+            out = put_str(out, ", ");
+            out = put_str(out, float_register_names[insn.rs1]);
+            return (insn.operands == OPERANDS_FRD_FRS1_RM ? put_rounding_mode(out, insn.imm) : out);
+        case OPERANDS_RD_FRS1:
+        case OPERANDS_RD_FRS1_RM:
+            out = put_str(out, register_names[insn.rd]);
+            out = put_str(out, ", ");
+            out = put_str(out, float_register_names[insn.rs1]);
+            return (insn.operands == OPERANDS_RD_FRS1_RM ? put_rounding_mode(out, insn.imm) : out);
+        case OPERANDS_RD_FRS1_FRS2:
+            out = put_str(out, register_names[insn.rd]);
+            out = put_str(out, ", ");
+            out = put_str(out, float_register_names[insn.rs1]);
+            out = put_str(out, ", ");
+            return put_str(out, float_register_names[insn.rs2]);
+        case OPERANDS_FRD_RS1:
+        case OPERANDS_FRD_RS1_RM:
+            out = put_str(out, float_register_names[insn.rd]);
+            out = put_str(out, ", ");
+            out = put_str(out, register_names[insn.rs1]);
+            return (insn.operands == OPERANDS_FRD_RS1_RM ? put_rounding_mode(out, insn.imm) : out);
+        default:
+            return out;
+    }
+}
+
+// Writes one line of the .text listing; mark is the label of the instruction itself, mark_offset the label of its target.
+// The line is "%08x %10s: <mnemonic> <operands>\n", with 16 address digits for ELF64.
+template<typename Insn>
+inline void print_insn(const Insn &insn, std::string_view mark, std::string_view mark_offset, Output_Buffer &output) {
+    char *out = output.reserve(2 * sizeof insn.address + 1 + std::max<size_t>(mark.size(), 10) + 2 + 16 + 1 + max_operands_length + mark_offset.size() + 1);
+    out = put_address(out, insn.address);
+    *out++ = ' ';
+    out = put_right(out, mark, 10);
+    out = put_str(out, ": ");
+    out = put_mnemonic(out, insn);
+    if (insn.operands != OPERANDS_NONE) {
+        *out++ = ' ';
+        out = put_operands(out, insn, mark_offset);
+    }
+    *out++ = '\n';
+    output.commit(out);
+}
+
+enum Operand_Field : uint16_t {
+    FIELD_RD = 1 << 0,
+    FIELD_RS1 = 1 << 1,
+    FIELD_RS2 = 1 << 2,
+    FIELD_IMM = 1 << 3,
+    FIELD_LABEL = 1 << 4,
+    FIELD_FRD = 1 << 5,     // rd, rs1, rs2 as f registers
+    FIELD_FRS1 = 1 << 6,
+    FIELD_FRS2 = 1 << 7,
+    FIELD_FRS3 = 1 << 8,
+    FIELD_RM = 1 << 9,
+    FIELD_CSR = 1 << 10,
+    FIELD_UIMM = 1 << 11,   // the immediate kept in rs1
+    FIELD_FENCE = 1 << 12
+};
+
+// The JSON fields of every OPERANDS_* layout.
+constexpr uint16_t operand_fields[] = {
+        0,
+        FIELD_RD | FIELD_IMM,
+        FIELD_RD | FIELD_LABEL,
+        FIELD_RD | FIELD_RS1 | FIELD_IMM,
+        FIELD_RD | FIELD_RS1 | FIELD_IMM,
+        FIELD_RS1 | FIELD_RS2 | FIELD_LABEL,
+        FIELD_RS1 | FIELD_RS2 | FIELD_IMM,
+        FIELD_RD | FIELD_RS1 | FIELD_RS2,
+        FIELD_RD | FIELD_RS2,
+        FIELD_RS1,
+        FIELD_RS1 | FIELD_LABEL,
+        FIELD_LABEL,
+        FIELD_FENCE,
+        FIELD_RD | FIELD_RS1 | FIELD_CSR,
+        FIELD_RD | FIELD_UIMM | FIELD_CSR,
+        FIELD_RD | FIELD_RS1,
+        FIELD_RD | FIELD_RS1 | FIELD_RS2,
+        FIELD_RD | FIELD_RS1,
+        FIELD_FRD | FIELD_RS1 | FIELD_IMM,
+        FIELD_RS1 | FIELD_FRS2 | FIELD_IMM,
+        FIELD_FRD | FIELD_FRS1 | FIELD_FRS2,
+        FIELD_FRD | FIELD_FRS1 | FIELD_FRS2 | FIELD_RM,
+        FIELD_FRD | FIELD_FRS1 | FIELD_FRS2 | FIELD_FRS3 | FIELD_RM,
+        FIELD_FRD | FIELD_FRS1,
+        FIELD_FRD | FIELD_FRS1 | FIELD_RM,
+        FIELD_RD | FIELD_FRS1,
+        FIELD_RD | FIELD_FRS1 | FIELD_RM,
+        FIELD_RD | FIELD_FRS1 | FIELD_FRS2,
+        FIELD_FRD | FIELD_RS1,
+        FIELD_FRD | FIELD_RS1 | FIELD_RM
+};
+static_assert(sizeof operand_fields / sizeof operand_fields[0] == OPERANDS_FRD_RS1_RM + 1, "a layout without JSON fields");
+
+inline char *put_json_register(char *out, std::string_view key, std::string_view name) {
+    out = put_str(out, key);
+    out = put_str(out, name);
+    *out++ = '"';
+    return out;
+}
+
+// Writes one instruction as a JSON object on its own line: address, length, label (only if it has one), mnemonic and
+// the operands its OPERANDS_* layout uses, by name: rd, rs1, rs2, rs3 (x or f registers), imm, rm, csr, pred and
+// succ, and target and target_label for jumps and branches.
+template<typename Insn>
+inline void print_insn_json(const Insn &insn, std::string_view mark, std::string_view mark_offset, Output_Buffer &output) {
+    char *out = output.reserve(256 + 6 * (mark.size() + mark_offset.size()));
+    out = put_str(out, "{\"type\":\"insn\",\"address\":");
+    out = put_uint(out, insn.address);
+    out = put_str(out, ",\"length\":");
+    out = put_int(out, insn.length);
+    if (!mark.empty()) {
+        out = put_str(out, ",\"label\":");
+        out = put_json_string(out, mark);
+    }
+    out = put_str(out, ",\"mnemonic\":\"");
+    out = put_mnemonic(out, insn);
+    *out++ = '"';
+    uint16_t fields = operand_fields[insn.operands];
+    if (fields & FIELD_RD) out = put_json_register(out, ",\"rd\":\"", register_names[insn.rd]);
+    if (fields & FIELD_FRD) out = put_json_register(out, ",\"rd\":\"", float_register_names[insn.rd]);
+    if (fields & FIELD_RS1) out = put_json_register(out, ",\"rs1\":\"", register_names[insn.rs1]);
+    if (fields & FIELD_FRS1) out = put_json_register(out, ",\"rs1\":\"", float_register_names[insn.rs1]);
+    if (fields & FIELD_RS2) out = put_json_register(out, ",\"rs2\":\"", register_names[insn.rs2]);
+    if (fields & FIELD_FRS2) out = put_json_register(out, ",\"rs2\":\"", float_register_names[insn.rs2]);
+    if (fields & FIELD_FRS3) out = put_json_register(out, ",\"rs3\":\"", float_register_names[(insn.imm >> 3) & 0b11111]);
+    if (fields & (FIELD_IMM | FIELD_UIMM)) {
+        out = put_str(out, ",\"imm\":");
+        out = put_int(out, (fields & FIELD_UIMM) != 0 ? insn.rs1 : insn.imm);
+    }
+    if (fields & FIELD_RM) out = put_json_register(out, ",\"rm\":\"", rounding_mode_names[insn.imm & 0b111]);
+    if (fields & FIELD_CSR) {
+        out = put_str(out, ",\"csr\":\"");
+        out = put_csr(out, insn.imm, sizeof insn.address == 8);
+        *out++ = '"';
+    }
+    if (fields & FIELD_FENCE) {
+        out = put_str(out, ",\"pred\":\"");
+        out = put_fence_set(out, insn.imm >> 4);
+        out = put_str(out, "\",\"succ\":\"");
+        out = put_fence_set(out, insn.imm & 0b1111);
+        *out++ = '"';
+    }
+    if (fields & FIELD_LABEL) {
+        out = put_str(out, ",\"target\":");
+        out = put_uint(out, insn.target);
+        out = put_str(out, ",\"target_label\":");
+        out = put_json_string(out, mark_offset);
+    }
+    out = put_str(out, "}\n");
+    output.commit(out);
+}
+
+#endif //LAB3_FORMAT_HPP
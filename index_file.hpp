@@ -0,0 +1,76 @@
+#ifndef LAB3_INDEX_FILE_HPP
+#define LAB3_INDEX_FILE_HPP
+
+#include "elf.hpp"
+
+#include <cstring>
+#include <string>
+
+#include <sys/stat.h>
+
+// Layout of the sidecar index written by Disassembler::open(path, index_path): this header, then the tables it points
+// to, each at an 8-byte aligned offset from the start of the file. Everything is in host byte order, so the index is
+// mapped and used as is; an index from another version or another host just fails the checks and is rebuilt. The
+// tables hold the addresses of the ELF class of the file (see Basic_Disassembler), which the content hash pins down.
+struct Index_File_Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t checkpoint_step;
+
+    // The ELF file the index was built from: size and content hash decide, the stat fields let a later run skip hashing.
+    uint64_t elf_size;
+    uint64_t elf_hash;
+    uint64_t elf_mtime_ns;
+    uint64_t elf_inode;
+    uint64_t elf_device;
+
+    uint64_t text_begin, text_end;
+    uint64_t entries_offset, entries_count;
+    uint64_t arena_offset, arena_size;
+    uint64_t text_bits_offset, text_bits_count;
+    uint64_t checkpoints_offset, checkpoints_count;
+    uint64_t intervals_offset, max_end_offset, by_name_offset, intervals_count;
+};
+
+static const char index_file_magic[8] = {'R', 'V', 'I', 'D', 'X', '0', '1', 0};
+// 2: labels of the targets in every code section, not only .text; 3: ELF64 files, with addresses and checkpoints as
+// wide as the ELF class.
+static const uint32_t index_file_version = 3;
+
+// 64-bit hash of the whole file, four independent lanes of 8-byte words so it runs near memory bandwidth.
+inline uint64_t content_hash(const uint8_t *data, size_t size) {
+    const uint64_t k = 0x9e3779b97f4a7c15ull;
+    uint64_t lanes[4] = {size, size ^ k, size + k, ~size};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (size_t j = 0; j < 4; j++) {
+            uint64_t word;
+            memcpy(&word, data + i + 8 * j, sizeof word);
+            lanes[j] = (lanes[j] ^ word) * k;
+            lanes[j] ^= lanes[j] >> 29;
+        }
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, size - i < 8 ? size - i : 8);
+    uint64_t hash = lanes[0] ^ tail;
+    for (size_t j = 1; j < 4; j++) hash = (hash ^ (lanes[j] >> 7)) * 0xff51afd7ed558ccdull + lanes[j];
+    for (i += 8; i < size; i++) hash = (hash ^ data[i]) * k;
+    return hash ^ (hash >> 32);
+}
+
+// Identity of the file at `path` as far as stat() can tell, or false if it cannot be stat'ed (a pipe, stdin).
+inline bool file_identity(const char *path, uint64_t &mtime_ns, uint64_t &inode, uint64_t &device) {
+    struct stat st{};
+    if (strcmp(path, "-") == 0 || stat(path, &st) != 0 || !S_ISREG(st.st_mode)) return false;
+    mtime_ns = (uint64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    inode = st.st_ino;
+    device = st.st_dev;
+    return true;
+}
+
+// The sidecar next to `path`, for the --index option.
+inline std::string default_index_path(const char *path) {
+    return std::string(path) + ".rvidx";
+}
+
+#endif //LAB3_INDEX_FILE_HPP
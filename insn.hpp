@@ -0,0 +1,371 @@
+#ifndef LAB3_INSN_HPP
+#define LAB3_INSN_HPP
+
+#include <cstdint>
+#include <string_view>
+
+enum Mnemonic : uint8_t {
+    MN_UNKNOWN,
+    MN_LUI,
+    MN_AUIPC,
+    MN_JAL,
+    MN_JALR,
+    MN_BEQ,
+    MN_BNE,
+    MN_BLT,
+    MN_BGE,
+    MN_BLTU,
+    MN_BGEU,
+    MN_LB,
+    MN_LH,
+    MN_LW,
+    MN_LBU,
+    MN_LHU,
+    MN_SB,
+    MN_SH,
+    MN_SW,
+    MN_ADDI,
+    MN_SLTI,
+    MN_SLTIU,
+    MN_XORI,
+    MN_ORI,
+    MN_ANDI,
+    MN_SLLI,
+    MN_SRLI,
+    MN_SRAI,
+    MN_ADD,
+    MN_SUB,
+    MN_SLL,
+    MN_SLT,
+    MN_SLTU,
+    MN_XOR,
+    MN_SRL,
+    MN_SRA,
+    MN_OR,
+    MN_AND,
+    MN_MUL,
+    MN_MULH,
+    MN_MULHSU,
+    MN_MULHU,
+    MN_DIV,
+    MN_DIVU,
+    MN_REM,
+    MN_REMU,
+    MN_C_ADDI4SPN,
+    MN_C_LW,
+    MN_C_SW,
+    MN_C_SUB,
+    MN_C_XOR,
+    MN_C_OR,
+    MN_C_AND,
+    MN_C_NOP,
+    MN_C_ADDI,
+    MN_C_LI,
+    MN_C_LUI,
+    MN_C_ADDI16SP,
+    MN_C_ANDI,
+    MN_C_SRLI,
+    MN_C_SRAI,
+    MN_C_SLLI,
+    MN_C_LWSP,
+    MN_C_JAL,
+    MN_C_J,
+    MN_C_BEQZ,
+    MN_C_BNEZ,
+    MN_C_EBREAK,
+    MN_C_JR,
+    MN_C_JALR,
+    MN_C_MV,
+    MN_C_ADD,
+    MN_C_SWSP,
+    // RV64 only
+    MN_LWU,
+    MN_LD,
+    MN_SD,
+    MN_ADDIW,
+    MN_SLLIW,
+    MN_SRLIW,
+    MN_SRAIW,
+    MN_ADDW,
+    MN_SUBW,
+    MN_SLLW,
+    MN_SRLW,
+    MN_SRAW,
+    MN_MULW,
+    MN_DIVW,
+    MN_DIVUW,
+    MN_REMW,
+    MN_REMUW,
+    MN_C_LD,
+    MN_C_SD,
+    MN_C_ADDIW,
+    MN_C_SUBW,
+    MN_C_ADDW,
+    MN_C_LDSP,
+    MN_C_SDSP,
+    // Always decoded: the rest of RV32I/RV64I and the privileged instructions
+    MN_ECALL,
+    MN_EBREAK,
+    MN_MRET,
+    MN_SRET,
+    MN_WFI,
+    MN_FENCE,
+    MN_FENCE_TSO,
+    // Zifencei
+    MN_FENCE_I,
+    // Zicsr
+    MN_CSRRW,
+    MN_CSRRS,
+    MN_CSRRC,
+    MN_CSRRWI,
+    MN_CSRRSI,
+    MN_CSRRCI,
+    // A; the .d forms are RV64 only
+    MN_LR_W,
+    MN_SC_W,
+    MN_AMOSWAP_W,
+    MN_AMOADD_W,
+    MN_AMOXOR_W,
+    MN_AMOAND_W,
+    MN_AMOOR_W,
+    MN_AMOMIN_W,
+    MN_AMOMAX_W,
+    MN_AMOMINU_W,
+    MN_AMOMAXU_W,
+    MN_LR_D,
+    MN_SC_D,
+    MN_AMOSWAP_D,
+    MN_AMOADD_D,
+    MN_AMOXOR_D,
+    MN_AMOAND_D,
+    MN_AMOOR_D,
+    MN_AMOMIN_D,
+    MN_AMOMAX_D,
+    MN_AMOMINU_D,
+    MN_AMOMAXU_D,
+    // F; the l[u] conversions are RV64 only, the c.f*w forms RV32 only
+    MN_FLW,
+    MN_FSW,
+    MN_FMADD_S,
+    MN_FMSUB_S,
+    MN_FNMSUB_S,
+    MN_FNMADD_S,
+    MN_FADD_S,
+    MN_FSUB_S,
+    MN_FMUL_S,
+    MN_FDIV_S,
+    MN_FSQRT_S,
+    MN_FSGNJ_S,
+    MN_FSGNJN_S,
+    MN_FSGNJX_S,
+    MN_FMIN_S,
+    MN_FMAX_S,
+    MN_FCVT_W_S,
+    MN_FCVT_WU_S,
+    MN_FCVT_L_S,
+    MN_FCVT_LU_S,
+    MN_FMV_X_W,
+    MN_FEQ_S,
+    MN_FLT_S,
+    MN_FLE_S,
+    MN_FCLASS_S,
+    MN_FCVT_S_W,
+    MN_FCVT_S_WU,
+    MN_FCVT_S_L,
+    MN_FCVT_S_LU,
+    MN_FMV_W_X,
+    MN_C_FLW,
+    MN_C_FSW,
+    MN_C_FLWSP,
+    MN_C_FSWSP,
+    // D; fmv.x.d, fmv.d.x and the l[u] conversions are RV64 only
+    MN_FLD,
+    MN_FSD,
+    MN_FMADD_D,
+    MN_FMSUB_D,
+    MN_FNMSUB_D,
+    MN_FNMADD_D,
+    MN_FADD_D,
+    MN_FSUB_D,
+    MN_FMUL_D,
+    MN_FDIV_D,
+    MN_FSQRT_D,
+    MN_FSGNJ_D,
+    MN_FSGNJN_D,
+    MN_FSGNJX_D,
+    MN_FMIN_D,
+    MN_FMAX_D,
+    MN_FCVT_W_D,
+    MN_FCVT_WU_D,
+    MN_FCVT_L_D,
+    MN_FCVT_LU_D,
+    MN_FMV_X_D,
+    MN_FEQ_D,
+    MN_FLT_D,
+    MN_FLE_D,
+    MN_FCLASS_D,
+    MN_FCVT_D_W,
+    MN_FCVT_D_WU,
+    MN_FCVT_D_L,
+    MN_FCVT_D_LU,
+    MN_FMV_D_X,
+    MN_FCVT_S_D,
+    MN_FCVT_D_S,
+    MN_C_FLD,
+    MN_C_FSD,
+    MN_C_FLDSP,
+    MN_C_FSDSP,
+    // Zba; the .uw forms are RV64 only
+    MN_SH1ADD,
+    MN_SH2ADD,
+    MN_SH3ADD,
+    MN_ADD_UW,
+    MN_SH1ADD_UW,
+    MN_SH2ADD_UW,
+    MN_SH3ADD_UW,
+    MN_SLLI_UW,
+    // Zbb; clz to zext.h take rs1 alone, the *w forms are RV64 only
+    MN_ANDN,
+    MN_ORN,
+    MN_XNOR,
+    MN_MAX,
+    MN_MAXU,
+    MN_MIN,
+    MN_MINU,
+    MN_ROL,
+    MN_ROR,
+    MN_RORI,
+    MN_ROLW,
+    MN_RORW,
+    MN_RORIW,
+    MN_CLZ,
+    MN_CTZ,
+    MN_CPOP,
+    MN_SEXT_B,
+    MN_SEXT_H,
+    MN_ORC_B,
+    MN_REV8,
+    MN_CLZW,
+    MN_CTZW,
+    MN_CPOPW,
+    MN_ZEXT_H,
+    // Zbs
+    MN_BCLR,
+    MN_BCLRI,
+    MN_BEXT,
+    MN_BEXTI,
+    MN_BINV,
+    MN_BINVI,
+    MN_BSET,
+    MN_BSETI,
+    MN_COUNT
+};
+
+constexpr std::string_view mnemonic_names[MN_COUNT] = {
+        "unknown_command", "lui", "auipc", "jal", "jalr", "beq", "bne", "blt", "bge", "bltu", "bgeu",
+        "lb", "lh", "lw", "lbu", "lhu", "sb", "sh", "sw",
+        "addi", "slti", "sltiu", "xori", "ori", "andi", "slli", "srli", "srai",
+        "add", "sub", "sll", "slt", "sltu", "xor", "srl", "sra", "or", "and",
+        "mul", "mulh", "mulhsu", "mulhu", "div", "divu", "rem", "remu",
+        "c.addi4spn", "c.lw", "c.sw", "c.sub", "c.xor", "c.or", "c.and", "c.nop", "c.addi", "c.li", "c.lui", "c.addi16sp",
+        "c.andi", "c.srli", "c.srai", "c.slli", "c.lwsp", "c.jal", "c.j", "c.beqz", "c.bnez", "c.ebreak", "c.jr", "c.jalr",
+        "c.mv", "c.add", "c.swsp",
+        "lwu", "ld", "sd", "addiw", "slliw", "srliw", "sraiw", "addw", "subw", "sllw", "srlw", "sraw",
+        "mulw", "divw", "divuw", "remw", "remuw", "c.ld", "c.sd", "c.addiw", "c.subw", "c.addw", "c.ldsp", "c.sdsp",
+        "ecall", "ebreak", "mret", "sret", "wfi", "fence", "fence.tso", "fence.i",
+        "csrrw", "csrrs", "csrrc", "csrrwi", "csrrsi", "csrrci",
+        "lr.w", "sc.w", "amoswap.w", "amoadd.w", "amoxor.w", "amoand.w", "amoor.w", "amomin.w", "amomax.w", "amominu.w", "amomaxu.w",
+        "lr.d", "sc.d", "amoswap.d", "amoadd.d", "amoxor.d", "amoand.d", "amoor.d", "amomin.d", "amomax.d", "amominu.d", "amomaxu.d",
+        "flw", "fsw", "fmadd.s", "fmsub.s", "fnmsub.s", "fnmadd.s", "fadd.s", "fsub.s", "fmul.s", "fdiv.s", "fsqrt.s", "fsgnj.s", "fsgnjn.s", "fsgnjx.s", "fmin.s", "fmax.s",
+        "fcvt.w.s", "fcvt.wu.s", "fcvt.l.s", "fcvt.lu.s", "fmv.x.w", "feq.s", "flt.s", "fle.s", "fclass.s", "fcvt.s.w", "fcvt.s.wu", "fcvt.s.l", "fcvt.s.lu", "fmv.w.x", "c.flw", "c.fsw", "c.flwsp", "c.fswsp",
+        "fld", "fsd", "fmadd.d", "fmsub.d", "fnmsub.d", "fnmadd.d", "fadd.d", "fsub.d", "fmul.d", "fdiv.d", "fsqrt.d", "fsgnj.d", "fsgnjn.d", "fsgnjx.d", "fmin.d", "fmax.d",
+        "fcvt.w.d", "fcvt.wu.d", "fcvt.l.d", "fcvt.lu.d", "fmv.x.d", "feq.d", "flt.d", "fle.d", "fclass.d", "fcvt.d.w", "fcvt.d.wu", "fcvt.d.l", "fcvt.d.lu", "fmv.d.x", "fcvt.s.d", "fcvt.d.s", "c.fld", "c.fsd", "c.fldsp", "c.fsdsp",
+        "sh1add", "sh2add", "sh3add", "add.uw", "sh1add.uw", "sh2add.uw", "sh3add.uw", "slli.uw",
+        "andn", "orn", "xnor", "max", "maxu", "min", "minu", "rol", "ror", "rori", "rolw", "rorw", "roriw",
+        "clz", "ctz", "cpop", "sext.b", "sext.h", "orc.b", "rev8", "clzw", "ctzw", "cpopw", "zext.h",
+        "bclr", "bclri", "bext", "bexti", "binv", "binvi", "bset", "bseti"
+};
+
+constexpr std::string_view register_names[32] = {"zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"};
+
+constexpr std::string_view float_register_names[32] = {"ft0", "ft1", "ft2", "ft3", "ft4", "ft5", "ft6", "ft7", "fs0", "fs1", "fa0", "fa1", "fa2", "fa3", "fa4", "fa5", "fa6", "fa7", "fs2", "fs3", "fs4", "fs5", "fs6", "fs7", "fs8", "fs9", "fs10", "fs11", "ft8", "ft9", "ft10", "ft11"};
+
+// Names of the CSRs known by name; the others are written as numbers. The upper halves of the counters (cycleh and
+// so on) exist on RV32 only.
+struct CSR_Name {
+    uint16_t number;
+    std::string_view name;
+    bool rv32_only = false;
+};
+
+constexpr CSR_Name csr_names[] = {
+        {0x001, "fflags"}, {0x002, "frm"}, {0x003, "fcsr"},
+        {0xc00, "cycle"}, {0xc01, "time"}, {0xc02, "instret"}, {0xc80, "cycleh", true}, {0xc81, "timeh", true}, {0xc82, "instreth", true},
+        {0x100, "sstatus"}, {0x104, "sie"}, {0x105, "stvec"}, {0x106, "scounteren"}, {0x140, "sscratch"}, {0x141, "sepc"},
+        {0x142, "scause"}, {0x143, "stval"}, {0x144, "sip"}, {0x180, "satp"},
+        {0xf11, "mvendorid"}, {0xf12, "marchid"}, {0xf13, "mimpid"}, {0xf14, "mhartid"},
+        {0x300, "mstatus"}, {0x301, "misa"}, {0x302, "medeleg"}, {0x303, "mideleg"}, {0x304, "mie"}, {0x305, "mtvec"},
+        {0x306, "mcounteren"}, {0x340, "mscratch"}, {0x341, "mepc"}, {0x342, "mcause"}, {0x343, "mtval"}, {0x344, "mip"},
+        {0xb00, "mcycle"}, {0xb02, "minstret"}, {0xb80, "mcycleh", true}, {0xb82, "minstreth", true}
+};
+
+// Rounding modes by the rm field; 5 and 6 are reserved and never decoded.
+constexpr std::string_view rounding_mode_names[8] = {"rne", "rtz", "rdn", "rup", "rmm", "", "", "dyn"};
+
+// How the operands of an instruction are written, e.g. OPERANDS_RD_IMM_RS1 is "rd, imm(rs1)".
+enum Operands : uint8_t {
+    OPERANDS_NONE,
+    OPERANDS_RD_IMM,
+    OPERANDS_RD_LABEL,
+    OPERANDS_RD_IMM_RS1,
+    OPERANDS_RD_RS1_IMM,
+    OPERANDS_RS1_RS2_LABEL,
+    OPERANDS_RS2_IMM_RS1,
+    OPERANDS_RD_RS1_RS2,
+    OPERANDS_RD_RS2,
+    OPERANDS_RS1,
+    OPERANDS_RS1_LABEL,
+    OPERANDS_LABEL,
+    OPERANDS_FENCE,                    // "pred, succ", imm = pred << 4 | succ
+    OPERANDS_RD_CSR_RS1,               // imm = csr
+    OPERANDS_RD_CSR_UIMM,              // imm = csr, rs1 = the 5-bit immediate
+    OPERANDS_RD_ADDR,                  // "rd, (rs1)"; imm = aq << 1 | rl, written as a suffix of the mnemonic
+    OPERANDS_RD_RS2_ADDR,              // "rd, rs2, (rs1)"; the same
+    OPERANDS_RD_RS1,
+    // Operands whose name starts with F are f registers; imm holds the rounding mode of the *_RM layouts.
+    OPERANDS_FRD_IMM_RS1,
+    OPERANDS_FRS2_IMM_RS1,
+    OPERANDS_FRD_FRS1_FRS2,
+    OPERANDS_FRD_FRS1_FRS2_RM,
+    OPERANDS_FRD_FRS1_FRS2_FRS3_RM,    // imm = rs3 << 3 | rm
+    OPERANDS_FRD_FRS1,
+    OPERANDS_FRD_FRS1_RM,
+    OPERANDS_RD_FRS1,
+    OPERANDS_RD_FRS1_RM,
+    OPERANDS_RD_FRS1_FRS2,
+    OPERANDS_FRD_RS1,
+    OPERANDS_FRD_RS1_RM
+};
+
+// One decoded instruction. Registers are full x0-x31 numbers (compressed rd'/rs1'/rs2' are already mapped to x8-x15),
+// or f0-f31 where the OPERANDS_* layout says so; imm is the sign-extended immediate as it is printed and target is
+// the absolute address a jump or branch goes to. has_target is set for every jal/branch encoding, including ones with
+// an unknown funct3. Addresses are as wide as the ELF class: DecodedInsn for ELF32 files, DecodedInsn64 for ELF64.
+template<typename Address>
+struct Basic_Insn {
+    Address address;
+    Address target;
+    int32_t imm;
+    uint8_t mnemonic;
+    uint8_t operands;
+    uint8_t rd;
+    uint8_t rs1;
+    uint8_t rs2;
+    uint8_t length;
+    uint8_t has_target;
+};
+
+using DecodedInsn = Basic_Insn<uint32_t>;
+using DecodedInsn64 = Basic_Insn<uint64_t>;
+
+#endif //LAB3_INSN_HPP
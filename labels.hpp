@@ -0,0 +1,156 @@
+#ifndef LAB3_LABELS_HPP
+#define LAB3_LABELS_HPP
+
+#include "elf.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Names of all labelled addresses: symbol names, plus LOC_xxxxx for jump and branch targets without a name.
+// Built once, then only read: looking up an address never creates a label. Names live in one NUL-separated arena,
+// entries are sorted by address, and a bitmap over the halfwords of .text answers "no label here" in one bit test.
+// The three arrays are either owned (after build()) or borrowed from an index file (after attach()). Address is the
+// address type of the ELF class; Label_Index is the ELF32 one.
+template<typename Address>
+class Basic_Label_Index {
+public:
+    struct Entry {
+        Address address;
+        uint32_t name;
+        uint32_t length;
+    };
+
+    // The index as flat arrays, for writing it to an index file and attaching it back without a copy.
+    struct Tables {
+        const Entry *entries;
+        size_t entries_count;
+        const char *arena;
+        size_t arena_size;
+        const uint64_t *text_bits;
+        size_t text_bits_count;
+        Address text_begin, text_end;
+    };
+
+private:
+    std::vector<Entry> entries;
+    std::string arena;
+    std::vector<uint64_t> text_bits;
+    Tables active{};
+
+    Entry add_name(Address address, const char *name, size_t length) {
+        Entry entry{address, (uint32_t)arena.size(), (uint32_t)length};
+        arena.append(name, length);
+        arena.push_back('\0');
+        return entry;
+    }
+
+    const Entry *lookup(Address address) const {
+        const Entry *end = active.entries + active.entries_count;
+        const Entry *it = std::lower_bound(active.entries, end, address, [](const Entry &entry, Address value) {
+            return entry.address < value;
+        });
+        if (it == end || it->address != address) return nullptr;
+        return it;
+    }
+
+public:
+    // Symbols with st_name != 0 name their st_value (the last such symbol wins), then every target in `targets`
+    // without a non-empty name gets LOC_xxxxx. `targets` is sorted and deduplicated in place.
+    template<typename Symbol>
+    void build(const Symbol *symbols, size_t symbols_count, const uint8_t *strtab, size_t strtab_size, std::vector<Address> &targets, Address text_address, Address text_size) {
+        entries.clear();
+        arena.clear();
+
+        std::vector<std::pair<Address, uint32_t>> named;
+        for (size_t i = 0; i < symbols_count; i++) {
+            if (symbols[i].st_name != 0) named.emplace_back(symbols[i].st_value, i);
+        }
+        std::stable_sort(named.begin(), named.end(), [](const std::pair<Address, uint32_t> &a, const std::pair<Address, uint32_t> &b) {
+            return a.first < b.first;
+        });
+        std::sort(targets.begin(), targets.end());
+        targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+        entries.reserve(named.size() + targets.size());
+        size_t t = 0;
+        for (size_t i = 0; i < named.size(); i++) {
+            if (i + 1 < named.size() && named[i + 1].first == named[i].first) continue;
+            Address address = named[i].first;
+            for (; t < targets.size() && targets[t] < address; t++) {
+                char buffer[24];
+                int length = sprintf(buffer, "LOC_%05llx", (unsigned long long)targets[t]);
+                entries.push_back(add_name(targets[t], buffer, length));
+            }
+            size_t begin = std::min<size_t>(symbols[named[i].second].st_name, strtab_size), end = begin;
+            while (end < strtab_size && strtab[end] != 0) end++;
+            if (end == begin && t < targets.size() && targets[t] == address) {
+                char buffer[24];
+                int length = sprintf(buffer, "LOC_%05llx", (unsigned long long)address);
+                entries.push_back(add_name(address, buffer, length));
+            } else {
+                entries.push_back(add_name(address, reinterpret_cast<const char *>(strtab) + begin, end - begin));
+            }
+            if (t < targets.size() && targets[t] == address) t++;
+        }
+        for (; t < targets.size(); t++) {
+            char buffer[24];
+            int length = sprintf(buffer, "LOC_%05llx", (unsigned long long)targets[t]);
+            entries.push_back(add_name(targets[t], buffer, length));
+        }
+
+        Address text_begin = text_address, text_end = text_address + text_size;
+        if (text_end < text_begin) text_end = std::numeric_limits<Address>::max();
+        text_bits.assign(((uint64_t)(text_end - text_begin) / 2 + 63) / 64, 0);
+        for (const Entry &entry : entries) {
+            if (entry.address >= text_begin && entry.address < text_end) {
+                size_t halfword = (entry.address - text_begin) / 2;
+                text_bits[halfword / 64] |= (uint64_t)1 << (halfword % 64);
+            }
+        }
+        active = {entries.data(), entries.size(), arena.data(), arena.size(), text_bits.data(), text_bits.size(), text_begin, text_end};
+    }
+
+    // Uses arrays owned by someone else (an mmap'ed index file) that must outlive the index or the next build().
+    void attach(const Tables &tables) {
+        entries.clear();
+        arena.clear();
+        text_bits.clear();
+        active = tables;
+    }
+
+    const Tables &tables() const {
+        return active;
+    }
+
+    // Name of the label at `address`, or an empty string. The returned view is NUL-terminated.
+    std::string_view find(Address address) const {
+        if (address >= active.text_begin && address < active.text_end && (address - active.text_begin) % 2 == 0) {
+            size_t halfword = (address - active.text_begin) / 2;
+            if ((active.text_bits[halfword / 64] & ((uint64_t)1 << (halfword % 64))) == 0) return "";
+        }
+        const Entry *entry = lookup(address);
+        if (entry == nullptr) return "";
+        return std::string_view(active.arena + entry->name, entry->length);
+    }
+
+    // Position of the label at `address` among all labels in address order, or UINT32_MAX if there is none.
+    uint32_t id(Address address) const {
+        const Entry *entry = lookup(address);
+        return (entry == nullptr ? UINT32_MAX : entry - active.entries);
+    }
+
+    size_t size() const {
+        return active.entries_count;
+    }
+
+    size_t memory_usage() const {
+        return entries.capacity() * sizeof(Entry) + arena.capacity() + text_bits.capacity() * sizeof(uint64_t);
+    }
+};
+
+using Label_Index = Basic_Label_Index<uint32_t>;
+
+#endif //LAB3_LABELS_HPP
@@ -1,327 +1,278 @@
-#include "rv32im.hpp"
-#include "rvc.hpp"
+#include "cfg.hpp"
+#include "disasm.hpp"
+#include "index_file.hpp"
+#include "parallel.hpp"
+#include "query.hpp"
+#include "server.hpp"
+#include "stats.hpp"
 
+#include <atomic>
 #include <iostream>
-#include <map>
+#include <memory>
+#include <mutex>
+#include <type_traits>
 
-class FileNotFoundException : public std::exception {
-private:
-    std::string error;
-public:
-    explicit FileNotFoundException(std::string err) : error(std::move(err)) {}
-    const char * what() const noexcept override {
-        return error.c_str();
-    }
-};
-
-class FileFormatException : public std::exception {
-private:
-    std::string error;
-public:
-    explicit FileFormatException(std::string err) : error(std::move(err)) {}
-    const char * what() const noexcept override {
-        return error.c_str();
-    }
-};
-
-#pragma pack(push, 1)
-
-struct ELF32_File_Header {
-    uint8_t e_ident[16];
-    uint16_t e_type;
-    uint16_t e_machine;
-    uint32_t e_version;
-    uint32_t e_entry;
-    uint32_t e_phoff;
-    uint32_t e_shoff;
-    uint32_t e_flags;
-    uint16_t e_ehsize;
-    uint16_t e_phentsize;
-    uint16_t e_phnum;
-    uint16_t e_shentsize;
-    uint16_t e_shnum;
-    uint16_t e_shstrndx;
-};
-
-struct ELF32_Section_Header {
-    uint32_t sh_name;
-    uint32_t sh_type;
-    uint32_t sh_flags;
-    uint32_t sh_addr;
-    uint32_t sh_offset;
-    uint32_t sh_size;
-    uint32_t sh_link;
-    uint32_t sh_info;
-    uint32_t sh_addralign;
-    uint32_t sh_entsize;
-};
-
-struct ELF32_Symbol {
-    uint32_t st_name;
-    uint32_t st_value;
-    uint32_t st_size;
-    uint8_t st_info;
-    uint8_t st_other;
-    uint16_t st_shndx;
-};
-
-#pragma pack(pop)
-
-std::string get_section_name(const ELF32_Section_Header &section_header, const uint8_t shstrtab[], size_t sz) {
-    std::string name = "";
-    size_t cur = section_header.sh_name;
-    while (cur < sz && shstrtab[cur] != 0) {
-        name += char(shstrtab[cur]);
-        cur++;
-    }
-    return name;
+// Where the listing of a batch input goes: output_dir/<file name><suffix>, or <input><suffix> without output_dir.
+std::string batch_output_path(const std::string &input, const std::string &output_dir, const std::string &suffix) {
+    if (output_dir.empty()) return input + suffix;
+    size_t slash = input.find_last_of('/');
+    return output_dir + "/" + input.substr(slash == std::string::npos ? 0 : slash + 1) + suffix;
 }
 
-std::string get_symbol_name(const ELF32_Symbol &symbol, const uint8_t strtab[], size_t sz) {
-    std::string name = "";
-    size_t cur = symbol.st_name;
-    while (cur < sz && strtab[cur] != 0) {
-        name += char(strtab[cur]);
-        cur++;
+// Input paths listed in a manifest, one per line; empty lines and lines starting with '#' are skipped.
+std::vector<std::string> read_manifest(const char *path) {
+    FILE *manifest = fopen(path, "r");
+    if (manifest == nullptr) throw FileNotFoundException("Unable to open manifest file!");
+    std::vector<std::string> inputs;
+    char *line = nullptr;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getline(&line, &capacity, manifest)) >= 0) {
+        while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r' || line[length - 1] == ' ')) length--;
+        if (length > 0 && line[0] != '#') inputs.emplace_back(line, length);
     }
-    return name;
+    free(line);
+    fclose(manifest);
+    return inputs;
 }
 
-std::string get_type(uint8_t type) {
-    if (type == 0) return "NOTYPE";
-    if (type == 1) return "OBJECT";
-    if (type == 2) return "FUNC";
-    if (type == 3) return "SECTION";
-    if (type == 4) return "FILE";
-    if (type == 5) return "COMMON";
-    if (type == 6) return "TLS";
-    if (type == 10) return "LOOS";    ///NOT SURE
-    if (type == 12) return "HIOS";    ///NOT SURE
-    if (type == 13) return "LOPROC";  ///NOT SURE
-    if (type == 15) return "HIPROC";  ///NOT SURE
-    return "";
+// Disassembles every input on a pool of `workers` threads, each with its own Disasm_Context (and Disasm_Stats, added
+// to options.stats at the end). A file that cannot be opened or parsed is reported on stderr and skipped. Returns
+// the number of files that failed.
+size_t disasm_batch(const std::vector<std::string> &inputs, const std::string &output_dir, const std::string &suffix, size_t workers, const Disasm_Options &options) {
+    std::atomic<size_t> next{0}, failed{0};
+    std::mutex stats_mutex;
+    run_parallel(std::max<size_t>(1, std::min(workers, inputs.size())), [&](size_t) {
+        Disasm_Context context;
+        ELF_Image input_image;
+        Disasm_Stats thread_stats;
+        Disasm_Options thread_options = options;
+        if (options.stats != nullptr) thread_options.stats = &thread_stats;
+        for (size_t i = next++; i < inputs.size(); i = next++) {
+            std::string output_path = batch_output_path(inputs[i], output_dir, suffix);
+            FILE *output_file = nullptr;
+            try {
+                input_image.load(inputs[i].c_str(), options.streaming);
+                output_file = fopen(output_path.c_str(), "w");
+                if (output_file == nullptr) throw FileNotFoundException("Unable to open output file!");
+                disasm(input_image, output_file, thread_options, context);
+            } catch (std::exception &e) {
+                context.output.clear();
+                context.output.set_file(nullptr);
+                fprintf(stderr, "%s: %s\n", inputs[i].c_str(), e.what());
+                failed++;
+                input_image.unload();
+                // Do not leave a truncated listing behind.
+                if (output_file != nullptr) {
+                    fclose(output_file);
+                    remove(output_path.c_str());
+                }
+                continue;
+            }
+            fclose(output_file);
+            input_image.unload();
+        }
+        if (options.stats != nullptr) {
+            std::lock_guard<std::mutex> lock(stats_mutex);
+            options.stats->add(thread_stats);
+        }
+    });
+    return failed;
 }
 
-std::string get_bind(uint8_t bind) {
-    if (bind == 0) return "LOCAL";
-    if (bind == 1) return "GLOBAL";
-    if (bind == 2) return "WEAK";
-    if (bind == 10) return "LOOS";    ///NOT SURE
-    if (bind == 12) return "HIOS";    ///NOT SURE
-    if (bind == 13) return "LOPROC";  ///NOT SURE
-    if (bind == 15) return "HIPROC";  ///NOT SURE
-    return "";
+// Number of threads for --jobs; 0 means one per hardware thread.
+size_t parse_jobs(const char *arg) {
+    char *end;
+    unsigned long jobs = strtoul(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || jobs > 1024) throw std::invalid_argument("Invalid number of jobs!");
+    if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+    return jobs;
 }
 
-std::string get_vis(uint8_t vis) {
-    if (vis == 0) return "DEFAULT";
-    if (vis == 1) return "INTERNAL";
-    if (vis == 2) return "HIDDEN";
-    if (vis == 3) return "PROTECTED";
-    return "";
+// Opens the file `input` of either ELF class, using the index at index_path if it is not nullptr.
+void open_input(Any_Disassembler &image, const char *input, const char *index_path) {
+    if (index_path != nullptr) image.open(input, index_path);
+    else image.open(input);
 }
 
-std::string get_index(uint16_t index) {
-    if (index == 0x0000) return "UNDEF";
-    if (index == 0xff00) return "BEFORE"; ///NOT SURE
-    if (index == 0xff01) return "AFTER";  ///NOT SURE
-    if (index == 0xff20) return "LOOS";   ///NOT SURE
-    if (index == 0xff3f) return "HIOS";   ///NOT SURE
-    if (index == 0xfff1) return "ABS";
-    if (index == 0xfff2) return "COMMON"; ///NOT SURE
-    if (index == 0xffff) return "XINDEX"; ///NOT SURE
-    return std::to_string(index);
+// Lists the instructions of `query` in the file `input`, using the index at index_path if it is not nullptr.
+void disasm_query(const char *input, const char *index_path, FILE *output_file, const Text_Query &query, Output_Format format) {
+    Any_Disassembler image;
+    open_input(image, input, index_path);
+    Output_Buffer output(output_file);
+    image.visit([&](const auto &disassembler) {
+        print_query(disassembler, query, output, format);
+    });
 }
 
-void print_symbol_info(const ELF32_Symbol &symbol, size_t idx, const std::string &name, FILE *output_file) {
-    uint8_t type = (symbol.st_info & 0xf), bind = (symbol.st_info >> 4), vis = (symbol.st_other & 0b11);
-    fprintf(output_file, "[%4i] 0x%-15X %5i %-8s %-8s %-8s %6s %s\n", (int)idx, symbol.st_value, symbol.st_size, get_type(type).c_str(), get_bind(bind).c_str(), get_vis(vis).c_str(), get_index(symbol.st_shndx).c_str(), name.c_str());
+// Writes the control-flow graph of the file `input`, using the index at index_path if it is not nullptr.
+void disasm_graph(const char *input, const char *index_path, FILE *output_file, Graph_Format format) {
+    Any_Disassembler image;
+    open_input(image, input, index_path);
+    Output_Buffer output(output_file);
+    image.visit([&](const auto &disassembler) {
+        using ELF = typename std::decay_t<decltype(disassembler)>::ELF_Class;
+        Basic_Flow_Graph<ELF> graph;
+        disassembler.flow_graph(graph);
+        disassembler.print_flow_graph(graph, output, format);
+    });
 }
 
-void disasm(FILE *input_file, FILE *output_file) {
-    ELF32_File_Header file_header{};
-    if (fread(&file_header, sizeof file_header, 1, input_file) != 1) throw FileFormatException("An error occurred while reading!");
-    if (file_header.e_ident[0] != 0x7f || file_header.e_ident[1] != 0x45 || file_header.e_ident[2] != 0x4c || file_header.e_ident[3] != 0x46) throw FileFormatException("Wrong format of input file!");
-
-    ELF32_Section_Header shstrtab_header{};
-    fseek(input_file, file_header.e_shoff + file_header.e_shstrndx * file_header.e_shentsize, SEEK_SET);
-    if (fread(&shstrtab_header, sizeof shstrtab_header, 1, input_file) != 1) throw FileFormatException("An error occurred while reading!");;
-
-    uint8_t shstrtab[shstrtab_header.sh_size];
-    fseek(input_file, shstrtab_header.sh_offset, SEEK_SET);
-    if (fread(&shstrtab, shstrtab_header.sh_size, 1, input_file) != 1) throw FileFormatException("An error occurred while reading!");
-    ELF32_Section_Header text_header{}, symtab_header{}, strtab_header{};
-
-    for (size_t i = 0; i < file_header.e_shnum; i++) {
-        ELF32_Section_Header section_header{};
-
-        fseek(input_file, file_header.e_shoff + i * file_header.e_shentsize, SEEK_SET);
-        if (fread(&section_header, sizeof section_header, 1, input_file) != 1) throw FileFormatException("An error occurred while reading!");
-
-        if (section_header.sh_name != 0) {
-            std::string name = get_section_name(section_header, shstrtab, shstrtab_header.sh_size);
-            if (name == ".text") std::swap(text_header, section_header);
-            if (name == ".symtab") std::swap(symtab_header, section_header);
-            if (name == ".strtab") std::swap(strtab_header, section_header);
+int main(int argc, char *argv[]) {
+    try {
+        std::vector<std::string> paths;
+        Disasm_Options options;
+        bool batch = false;
+        std::string output_dir, suffix = ".txt";
+        Text_Query query;
+        bool use_index = false;
+        std::string index_path, socket_path;
+        Serve_Options serve_options;
+        bool graph = false;
+        Graph_Format graph_format = GRAPH_DOT;
+        Disasm_Stats stats;
+        bool stats_json = false;
+        for (int i = 1; i < argc; i++) {
+            std::string_view arg = argv[i];
+            bool has_value = (i + 1 < argc);
+            if (arg == "--single-pass") {
+                options.single_pass = true;
+            } else if (arg == "--stream") {
+                options.streaming = true;
+            } else if (arg == "--batch") {
+                batch = true;
+            } else if (arg == "--jobs" && has_value) {
+                options.jobs = parse_jobs(argv[++i]);
+            } else if (arg == "--manifest" && has_value) {
+                batch = true;
+                std::vector<std::string> inputs = read_manifest(argv[++i]);
+                paths.insert(paths.end(), inputs.begin(), inputs.end());
+            } else if (arg == "--output-dir" && has_value) {
+                output_dir = argv[++i];
+            } else if (arg == "--suffix" && has_value) {
+                suffix = argv[++i];
+            } else if (arg == "--symbol" && has_value) {
+                query.symbol = argv[++i];
+            } else if (arg == "--range" && has_value) {
+                std::string_view range = argv[++i];
+                size_t colon = range.find(':');
+                if (colon == std::string_view::npos) throw std::invalid_argument("Invalid address!");
+                query.begin = parse_address(range.substr(0, colon));
+                query.end = parse_address(range.substr(colon + 1));
+                query.has_range = true;
+            } else if (arg == "--pc" && has_value) {
+                query.pc = parse_address(argv[++i]);
+                query.has_pc = true;
+            } else if (arg == "--context" && has_value) {
+                query.context = parse_address(argv[++i]);
+            } else if (arg == "--index") {
+                use_index = true;
+            } else if (arg == "--index-file" && has_value) {
+                use_index = true;
+                index_path = argv[++i];
+            } else if (arg == "--format" && has_value) {
+                std::string_view format = argv[++i];
+                if (format == "text") options.format = FORMAT_TEXT;
+                else if (format == "columnar") options.format = FORMAT_COLUMNAR;
+                else if (format == "jsonl") options.format = FORMAT_JSONL;
+                else throw std::invalid_argument("Invalid output format!");
+            } else if (arg == "--cfg" && has_value) {
+                std::string_view format = argv[++i];
+                if (format == "dot") graph_format = GRAPH_DOT;
+                else if (format == "binary") graph_format = GRAPH_BINARY;
+                else throw std::invalid_argument("Invalid output format!");
+                graph = true;
+            } else if (arg == "--stats" && has_value) {
+                std::string_view format = argv[++i];
+                if (!stats_enabled) throw std::invalid_argument("Statistics are not compiled in!");
+                if (format == "text") stats_json = false;
+                else if (format == "json") stats_json = true;
+                else throw std::invalid_argument("Invalid output format!");
+                options.stats = &stats;
+            } else if (arg == "--serve" && has_value) {
+                socket_path = argv[++i];
+            } else if (arg == "--cache-size" && has_value) {
+                serve_options.cache_size = parse_address(argv[++i]);
+            } else if (arg == "--max-connections" && has_value) {
+                serve_options.max_connections = parse_address(argv[++i]);
+            } else if (arg.substr(0, 2) == "--") {
+                throw std::invalid_argument("Invalid number of arguments!");
+            } else {
+                paths.emplace_back(arg);
+            }
         }
-    }
-
-    uint8_t strtab[strtab_header.sh_size];
-    fseek(input_file, strtab_header.sh_offset, SEEK_SET);
-    if (fread(&strtab, strtab_header.sh_size, 1, input_file) != 1) throw FileFormatException("An error occurred while reading!");
-
-    ELF32_Symbol tmp{};
-    ELF32_Symbol symbols[symtab_header.sh_size / sizeof tmp];
-    std::map<uint32_t, std::string> marks;
-
-    size_t cur = 0;
-    for (size_t i = 0; i < symtab_header.sh_size; i += sizeof tmp) {
-        fseek(input_file, symtab_header.sh_offset + cur * sizeof tmp, SEEK_SET);
-        if (fread(&symbols[cur], sizeof tmp, 1, input_file) != 1) throw FileFormatException("An error occurred while reading!");
-
-        if (symbols[cur].st_name != 0) {
-            marks[symbols[cur].st_value] = get_symbol_name(symbols[cur], strtab, strtab_header.sh_size);;
+        if (options.streaming) {
+            // Both would keep a whole copy of .text (decoded, or as chunk listings) in memory.
+            options.single_pass = false;
+            if (!batch) options.jobs = 1;
         }
-        cur++;
-    }
-
-    cur = 0;
-    uint32_t cur_address = text_header.sh_addr;
-    fseek(input_file, text_header.sh_offset, SEEK_SET);
-    while (cur < text_header.sh_size) {
-        uint16_t part1;
-        if (fread(&part1, sizeof part1, 1, input_file) != 1) throw FileFormatException("An error occurred while reading!");
-        if ((part1 & 0b11) != 0b11) {
-            uint16_t command = part1;
-            if ((command & 0b11) == 0b01 && (((command >> 13) & 0b111) == 0b001 || ((command >> 13) & 0b111) == 0b101)) {
-                int16_t offset = (((command >> 12) & 0b1) << 11) + (((command >> 8) & 0b1) << 10) + (((command >> 9) & 0b11) << 8) + (((command >> 6) & 0b1) << 7) + (((command >> 7) & 0b1) << 6) + (((command >> 2) & 0b1) << 5) + (((command >> 11) & 0b1) << 4) + (((command >> 3) & 0b111) << 1);
-                if ((offset & (1 << 11)) != 0) offset = (offset | 0xf000);
-                if (marks[cur_address + offset].empty()) {
-                    char buffer[15];
-                    sprintf(buffer, "LOC_%05x", cur_address + offset);
-                    marks[cur_address + offset] = buffer;
-                }
-            }
-            if ((command & 0b11) == 0b01 && (((command >> 13) & 0b111) == 0b110 || ((command >> 13) & 0b111) == 0b111)) {
-                int16_t offset = (((command >> 12) & 0b1) << 8) + (((command >> 5) & 0b11) << 6) + (((command >> 2) & 0b1) << 5) + (((command >> 10) & 0b11) << 3) + (((command >> 3) & 0b11) << 1);
-                if ((offset & (1 << 8)) != 0) {
-                    offset = (offset | 0xff00);
-                }
-                if (marks[cur_address + offset].empty()) {
-                    char buffer[15];
-                    sprintf(buffer, "LOC_%05x", cur_address + offset);
-                    marks[cur_address + offset] = buffer;
-                }
-            }
-            cur_address += 2;
-            cur += 2;
-        } else {
-            uint16_t part2;
-            if (fread(&part2, sizeof part2, 1, input_file) != 1) throw FileFormatException("An error occurred while reading!");
-            uint32_t command = (part2 << 16) + part1;
-            int32_t offset;
-            if ((command & 0b1111111) == 0b1101111) {
-                offset = (((command >> 31) & 0b1) << 20) + (((command >> 12) & 0xff) << 12) + (((command >> 20) & 0b1) << 11) + (((command >> 21) & 0x3ff) << 1);
-                if ((offset & (1 << 20)) != 0) {
-                    offset = (offset | 0xffe00000);
-                }
-                if (marks[cur_address + offset].empty()) {
-                    char buffer[15];
-                    sprintf(buffer, "LOC_%05x", cur_address + offset);
-                    marks[cur_address + offset] = buffer;
-                }
-            }
-            if ((command & 0b1111111) == 0b1100011) {
-                offset = (((command >> 31) & 0b1) << 12) + (((command >> 7) & 0b1) << 11) + (((command >> 25) & 0b111111) << 5) + (((command >> 8) & 0b1111) << 1);
-                if ((offset & (1 << 12)) != 0) {
-                    offset = (offset | 0xffffe000);
-                }
-                if (marks[cur_address + offset].empty()) {
-                    char buffer[15];
-                    sprintf(buffer, "LOC_%05x", cur_address + offset);
-                    marks[cur_address + offset] = buffer;
-                }
-            }
-            cur_address += 4;
-            cur += 4;
+        // The columnar format is written by disasm() from .text decoded in full, which has no use for the index.
+        if (use_index && options.format == FORMAT_COLUMNAR) throw std::invalid_argument("The index is not used for the columnar format!");
+        // --stats watches disasm(), which the queries, the index, the graph and the server do not go through.
+        if (options.stats != nullptr && (!socket_path.empty() || graph || !query.empty() || use_index)) {
+            throw std::invalid_argument("Statistics are only collected for the listing!");
         }
-    }
-
-    fprintf(output_file, ".text\n");
-
-    cur = 0;
-    cur_address = text_header.sh_addr;
-    fseek(input_file, text_header.sh_offset, SEEK_SET);
-    while (cur < text_header.sh_size) {
-        uint16_t part1;
-        if (fread(&part1, sizeof part1, 1, input_file) != 1) throw FileFormatException("An error occurred while reading!");
-        if ((part1 & 0b11) != 0b11) {
-            uint16_t command = part1;
-            std::string mark_offset;
-            if ((command & 0b11) == 0b01 && (((command >> 13) & 0b111) == 0b001 || ((command >> 13) & 0b111) == 0b101)) {
-                int16_t offset = (((command >> 12) & 0b1) << 11) + (((command >> 8) & 0b1) << 10) + (((command >> 9) & 0b11) << 8) + (((command >> 6) & 0b1) << 7) + (((command >> 7) & 0b1) << 6) + (((command >> 2) & 0b1) << 5) + (((command >> 11) & 0b1) << 4) + (((command >> 3) & 0b111) << 1);
-                if ((offset & (1 << 11)) != 0) offset = (offset | 0xf000);
-                mark_offset = marks[cur_address + offset];
-            }
-            if ((command & 0b11) == 0b01 && (((command >> 13) & 0b111) == 0b110 || ((command >> 13) & 0b111) == 0b111)) {
-                int16_t offset = (((command >> 12) & 0b1) << 8) + (((command >> 5) & 0b11) << 6) + (((command >> 2) & 0b1) << 5) + (((command >> 10) & 0b11) << 3) + (((command >> 3) & 0b11) << 1);
-                if ((offset & (1 << 8)) != 0) {
-                    offset = (offset | 0xff00);
-                }
-                mark_offset = marks[cur_address + offset];
-            }
-            rvc(part1, cur_address, marks[cur_address], mark_offset, output_file);
-            cur_address += 2;
-            cur += 2;
-        } else {
-            uint16_t part2;
-            if (fread(&part2, sizeof part2, 1, input_file) != 1) throw FileFormatException("An error occurred while reading!");
-            uint32_t command = (part2 << 16) + part1;
-            int32_t offset;
-            std::string mark_offset;
-            if ((command & 0b1111111) == 0b1101111) {
-                offset = (((command >> 31) & 0b1) << 20) + (((command >> 12) & 0xff) << 12) + (((command >> 20) & 0b1) << 11) + (((command >> 21) & 0x3ff) << 1);
-                if ((offset & (1 << 20)) != 0) {
-                    offset = (offset | 0xffe00000);
-                }
-                mark_offset = marks[cur_address + offset];
-            }
-            if ((command & 0b1111111) == 0b1100011) {
-                offset = (((command >> 31) & 0b1) << 12) + (((command >> 7) & 0b1) << 11) + (((command >> 25) & 0b111111) << 5) + (((command >> 8) & 0b1111) << 1);
-                if ((offset & (1 << 12)) != 0) {
-                    offset = (offset | 0xffffe000);
-                }
-                mark_offset = marks[cur_address + offset];
+        auto report_stats = [&]() {
+            if (options.stats == nullptr) return;
+            Output_Buffer stats_output(stderr);
+            print_stats(stats, stats_json, stats_output);
+        };
+        if (!socket_path.empty()) {
+            if (!paths.empty()) throw std::invalid_argument("Invalid number of arguments!");
+            serve_options.use_index = use_index && index_path.empty();
+            serve(socket_path.c_str(), serve_options);
+        }
+        if (batch) {
+            // In batch mode --jobs is the number of files processed at once; each file is disassembled by one thread.
+            size_t workers = options.jobs;
+            options.jobs = 1;
+            size_t failed = disasm_batch(paths, output_dir, suffix, workers, options);
+            report_stats();
+            if (failed != 0) {
+                std::cerr << "Failed to disassemble " << failed << " of " << paths.size() << " files\n";
+                return 3;
             }
-            rv32im(command, cur_address, marks[cur_address], mark_offset, output_file);
-            cur_address += 4;
-            cur += 4;
+            return 0;
         }
-    }
-
-    fprintf(output_file, "\n.symtab\n");
-    fprintf(output_file, "%s %-15s %7s %-8s %-8s %-8s %6s %s\n", "Symbol", "Value", "Size", "Type", "Bind", "Vis", "Index", "Name");
-
-    cur = 0;
-    for (size_t i = 0; i < symtab_header.sh_size; i += sizeof tmp) {
-        if (symbols[cur].st_name != 0) {
-            print_symbol_info(symbols[cur], cur, marks[symbols[cur].st_value], output_file);
-        } else {
-            print_symbol_info(symbols[cur], cur, "", output_file);
+        if (paths.size() != 2) throw std::invalid_argument("Invalid number of arguments!");
+        if (use_index && index_path.empty()) index_path = default_index_path(paths[0].c_str());
+        if (graph) {
+            if (!query.empty()) throw std::invalid_argument("Invalid number of arguments!");
+            FILE *output_file = fopen(paths[1].c_str(), "w");
+            if (output_file == nullptr) throw FileNotFoundException("Unable to open output file!");
+            disasm_graph(paths[0].c_str(), use_index ? index_path.c_str() : nullptr, output_file, graph_format);
+            fclose(output_file);
+            return 0;
         }
-        cur++;
-    }
-}
-
-int main(int argc, char *argv[]) {
-    try {
-        if (argc != 3) throw std::invalid_argument("Invalid number of arguments!");
-        FILE *input_file = fopen(argv[1], "rb"), *output_file = fopen(argv[2], "w");
-        if (input_file == nullptr) throw FileNotFoundException("Unable to open input file!");
+        if (!query.empty()) {
+            if (options.format == FORMAT_COLUMNAR) throw std::invalid_argument("Invalid output format!");
+            FILE *output_file = fopen(paths[1].c_str(), "w");
+            if (output_file == nullptr) throw FileNotFoundException("Unable to open output file!");
+            disasm_query(paths[0].c_str(), use_index ? index_path.c_str() : nullptr, output_file, query, options.format);
+            fclose(output_file);
+            return 0;
+        }
+        if (use_index) {
+            // The labels come from the index, so the listing is a single pass over the code sections.
+            Any_Disassembler image;
+            image.open(paths[0].c_str(), index_path.c_str());
+            FILE *output_file = fopen(paths[1].c_str(), "w");
+            if (output_file == nullptr) throw FileNotFoundException("Unable to open output file!");
+            Output_Buffer output(output_file);
+            image.visit([&](const auto &disassembler) {
+                disassembler.print_listing(output, options.format);
+            });
+            output.flush();
+            fclose(output_file);
+            return 0;
+        }
+        ELF_Image input_image(paths[0].c_str(), options.streaming);
+        FILE *output_file = fopen(paths[1].c_str(), "w");
         if (output_file == nullptr) throw FileNotFoundException("Unable to open output file!");
-        disasm(input_file, output_file);
-        fclose(input_file);
+        Disasm_Context context;
+        disasm(input_image, output_file, options, context);
         fclose(output_file);
+        report_stats();
     } catch (std::invalid_argument &e) {
         std::cerr << e.what() << '\n';
         return 1;
@@ -0,0 +1,217 @@
+#ifndef LAB3_OUTPUT_HPP
+#define LAB3_OUTPUT_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+inline char *put_str(char *out, std::string_view str) {
+    memcpy(out, str.data(), str.size());
+    return out + str.size();
+}
+
+// str right-aligned in `width` columns, like "%10s".
+inline char *put_right(char *out, std::string_view str, size_t width) {
+    if (str.size() < width) {
+        memset(out, ' ', width - str.size());
+        out += width - str.size();
+    }
+    return put_str(out, str);
+}
+
+// str left-aligned in `width` columns, like "%-8s".
+inline char *put_left(char *out, std::string_view str, size_t width) {
+    out = put_str(out, str);
+    if (str.size() < width) {
+        memset(out, ' ', width - str.size());
+        out += width - str.size();
+    }
+    return out;
+}
+
+// Eight lowercase hex digits, like "%08x".
+inline char *put_hex8(char *out, uint32_t value) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 7; i >= 0; i--) {
+        out[i] = digits[value & 0xf];
+        value >>= 4;
+    }
+    return out + 8;
+}
+
+// An address the width of the ELF class: put_hex8 for ELF32, sixteen hex digits ("%016llx") for ELF64.
+inline char *put_address(char *out, uint32_t address) {
+    return put_hex8(out, address);
+}
+
+inline char *put_address(char *out, uint64_t address) {
+    out = put_hex8(out, address >> 32);
+    return put_hex8(out, address);
+}
+
+// Uppercase hex without leading zeros, like "%X".
+inline char *put_hex_upper(char *out, uint64_t value) {
+    static const char digits[] = "0123456789ABCDEF";
+    char buffer[16];
+    int length = 0;
+    do {
+        buffer[length++] = digits[value & 0xf];
+        value >>= 4;
+    } while (value != 0);
+    while (length > 0) *out++ = buffer[--length];
+    return out;
+}
+
+// Decimal, like "%llu".
+inline char *put_uint(char *out, uint64_t value) {
+    char buffer[20];
+    int length = 0;
+    do {
+        buffer[length++] = char('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    while (length > 0) *out++ = buffer[--length];
+    return out;
+}
+
+// Decimal, like "%d".
+inline char *put_int(char *out, int64_t value) {
+    uint64_t magnitude = value;
+    if (value < 0) {
+        *out++ = '-';
+        magnitude = -magnitude;
+    }
+    return put_uint(out, magnitude);
+}
+
+// str as a JSON string literal, quotes included: at most 2 + 6 * str.size() bytes. Control characters and bytes from
+// 0x80 up are written as \u00XX, so the result is plain ASCII and valid JSON whatever bytes .strtab holds.
+inline char *put_json_string(char *out, std::string_view str) {
+    static const char digits[] = "0123456789abcdef";
+    *out++ = '"';
+    for (unsigned char c : str) {
+        if (c >= 0x20 && c < 0x80 && c != '"' && c != '\\') {
+            *out++ = c;
+        } else if (c == '"' || c == '\\') {
+            *out++ = '\\';
+            *out++ = c;
+        } else {
+            out = put_str(out, "\\u00");
+            *out++ = digits[c >> 4];
+            *out++ = digits[c & 0xf];
+        }
+    }
+    *out++ = '"';
+    return out;
+}
+
+// value right-aligned in `width` columns, like "%5i".
+inline char *put_int_right(char *out, int64_t value, size_t width) {
+    char buffer[24];
+    return put_right(out, std::string_view(buffer, put_int(buffer, value) - buffer), width);
+}
+
+// Text output collected in one large reusable buffer. With a FILE it is flushed in blocks of `capacity` bytes;
+// without one (file == nullptr) it only grows, and the caller takes the text with view().
+// Lines are written by reserving an upper bound of their length and committing the end pointer:
+//     char *out = buffer.reserve(64);
+//     out = put_hex8(out, address);
+//     buffer.commit(out);
+class Output_Buffer {
+private:
+    FILE *file;
+    std::vector<char> data;
+    size_t used = 0;
+
+    void put(const char *text, size_t length) {
+#ifdef LAB3_STATS
+        auto start = std::chrono::steady_clock::now();
+        fwrite(text, 1, length, file);
+        write_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        written_bytes += length;
+#else
+        fwrite(text, 1, length, file);
+#endif
+    }
+
+public:
+#ifdef LAB3_STATS
+    // Bytes handed to fwrite so far and the seconds it took, for --stats (see stats.hpp).
+    uint64_t written_bytes = 0;
+    double write_seconds = 0;
+#endif
+
+    explicit Output_Buffer(FILE *file, size_t capacity = 1 << 20) : file(file), data(capacity) {}
+
+    Output_Buffer(const Output_Buffer &) = delete;
+    Output_Buffer &operator=(const Output_Buffer &) = delete;
+
+    ~Output_Buffer() {
+        flush();
+    }
+
+    char *reserve(size_t length) {
+        if (used + length > data.size()) {
+            flush();
+            if (used + length > data.size()) data.resize(std::max(data.size() * 2, used + length));
+        }
+        return data.data() + used;
+    }
+
+    void commit(char *end) {
+        used = end - data.data();
+    }
+
+    void write(std::string_view str) {
+        if (file != nullptr && str.size() >= data.size()) {
+            flush();
+            put(str.data(), str.size());
+            return;
+        }
+        commit(put_str(reserve(str.size()), str));
+    }
+
+    // printf-style output for the rare lines that are not worth hand-formatting.
+    void print(const char *format, ...) {
+        va_list args, copy;
+        va_start(args, format);
+        va_copy(copy, args);
+        int length = vsnprintf(nullptr, 0, format, copy);
+        va_end(copy);
+        if (length > 0) {
+            char *out = reserve(length + 1);
+            vsnprintf(out, length + 1, format, args);
+            commit(out + length);
+        }
+        va_end(args);
+    }
+
+    // Flushes what was written so far and sends the following text to `file` instead.
+    void set_file(FILE *new_file) {
+        flush();
+        file = new_file;
+    }
+
+    void flush() {
+        if (file != nullptr && used > 0) {
+            put(data.data(), used);
+            used = 0;
+        }
+    }
+
+    // Buffered text; all of it when there is no FILE.
+    std::string_view view() const {
+        return std::string_view(data.data(), used);
+    }
+
+    void clear() {
+        used = 0;
+    }
+};
+
+#endif //LAB3_OUTPUT_HPP
@@ -0,0 +1,119 @@
+#ifndef LAB3_PARALLEL_HPP
+#define LAB3_PARALLEL_HPP
+
+#include "prescan.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <thread>
+#include <vector>
+
+// Runs fn(0), ..., fn(count - 1) on `count` threads, the calling thread taking fn(0).
+// Waits for all of them and rethrows the first exception thrown, if any.
+template<typename Function>
+inline void run_parallel(size_t count, Function fn) {
+    std::vector<std::exception_ptr> errors(count);
+    std::vector<std::thread> threads;
+    threads.reserve(count);
+    auto run = [&](size_t idx) {
+        try {
+            fn(idx);
+        } catch (...) {
+            errors[idx] = std::current_exception();
+        }
+    };
+    for (size_t i = 1; i < count; i++) threads.emplace_back(run, i);
+    if (count > 0) run(0);
+    for (std::thread &thread : threads) thread.join();
+    for (std::exception_ptr &error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+}
+
+// Runs fn(0, worker), ..., fn(count - 1, worker) on `threads` threads with work stealing, for items whose costs vary
+// a lot. Every worker owns a range of items, starting with an equal share in order, and takes items from its front;
+// one that runs out steals the back half of the largest range left. A range is one atomic word (begin << 32 | end),
+// so taking and stealing are a compare-and-swap each. `worker` (below `threads`) tells which thread runs the item.
+// Rethrows the first exception thrown, if any, after all threads are done.
+template<typename Function>
+inline void run_stealing(size_t count, size_t threads, Function fn) {
+    threads = std::max<size_t>(1, std::min(threads, count));
+    struct alignas(64) Range {
+        std::atomic<uint64_t> bounds;
+    };
+    auto pack = [](uint64_t begin, uint64_t end) {
+        return begin << 32 | end;
+    };
+    std::vector<Range> ranges(threads);
+    for (size_t t = 0; t < threads; t++) ranges[t].bounds = pack(count * t / threads, count * (t + 1) / threads);
+
+    run_parallel(threads, [&](size_t t) {
+        std::atomic<uint64_t> &own = ranges[t].bounds;
+        for (;;) {
+            uint64_t bounds = own.load();
+            while ((bounds >> 32) < (uint32_t)bounds) {
+                if (own.compare_exchange_weak(bounds, bounds + (uint64_t(1) << 32))) {
+                    fn(bounds >> 32, t);
+                    bounds = own.load();
+                }
+            }
+            // Steal from the victim with the most items left; give up once every range is empty.
+            bool stolen = false;
+            while (!stolen) {
+                size_t victim = threads;
+                uint64_t most = 0, seen = 0;
+                for (size_t v = 0; v < threads; v++) {
+                    uint64_t b = ranges[v].bounds.load(), left = (uint32_t)b - std::min<uint64_t>(b >> 32, (uint32_t)b);
+                    if (left > most) victim = v, most = left, seen = b;
+                }
+                if (victim == threads) return;
+                uint64_t begin = seen >> 32, end = (uint32_t)seen, middle = begin + (end - begin) / 2;
+                if (ranges[victim].bounds.compare_exchange_strong(seen, pack(begin, middle))) {
+                    own.store(pack(middle, end));
+                    stolen = true;
+                }
+            }
+        }
+    });
+}
+
+inline size_t next_boundary(const uint8_t *text, size_t pos) {
+    return pos + ((text[pos] & 0b11) == 0b11 ? 4 : 2);
+}
+
+// Splits .text into at most `count` chunks that start on instruction boundaries; chunk k is [starts[k], starts[k + 1]).
+// A halfword in the middle of .text is either an instruction start or the upper half of a 32-bit instruction, so every
+// thread walks its chunk from both its nominal start s and s + 2 (the two walks usually meet after a few instructions),
+// and the rest of the chunk is skipped with the pre-scan.
+// Once the exits of all chunks are known, the real starts are chained from the beginning of .text in O(chunks).
+// The chunks are walked by `threads` workers of run_stealing(), not a thread each.
+inline std::vector<size_t> split_text(const uint8_t *text, size_t size, size_t count, size_t threads) {
+    const size_t min_chunk = 4096;
+    if (count > size / min_chunk) count = size / min_chunk;
+    if (count == 0) count = 1;
+
+    std::vector<size_t> nominal(count + 1);
+    for (size_t k = 0; k < count; k++) nominal[k] = (size / count * k) & ~(size_t)1;
+    nominal[count] = size;
+
+    std::vector<std::array<size_t, 2>> exits(count);
+    run_stealing(count, threads, [&](size_t k, size_t) {
+        size_t a = nominal[k], b = nominal[k] + 2, end = nominal[k + 1];
+        while (a != b && (a < end || b < end)) {
+            if (a < b) a = next_boundary(text, a); else b = next_boundary(text, b);
+        }
+        if (a == b) a = b = skip_instructions(text, a, end);
+        exits[k] = {a, b};
+    });
+
+    std::vector<size_t> starts(count + 1);
+    starts[0] = 0;
+    for (size_t k = 0; k + 1 < count; k++) starts[k + 1] = exits[k][starts[k] == nominal[k] ? 0 : 1];
+    starts[count] = size;
+    return starts;
+}
+
+#endif //LAB3_PARALLEL_HPP
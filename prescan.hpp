@@ -0,0 +1,158 @@
+#ifndef LAB3_PRESCAN_HPP
+#define LAB3_PRESCAN_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LAB3_PRESCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// Pre-scan of code for instruction boundaries and jump candidates, 64 halfword parcels (a block of 128 bytes) at a
+// time. For every parcel a kernel sets a bit in `shorts` if its low two bits are not 0b11, that is if it is a 16-bit
+// instruction when an instruction starts there, and a bit in `candidates` if it may be a jump or branch with a
+// target: jal and the branches by their 7-bit opcode, c.jal (c.addiw on RV64), c.j, c.beqz and c.bnez by quadrant and
+// funct3. Which parcels do start instructions is then worked out 64 at a time by block_starts(), so the label pass
+// decodes only the candidates among them and chunk splitting decodes nothing at all.
+const size_t prescan_block_bytes = 128;
+
+using Prescan_Kernel = void (*)(const uint8_t *data, size_t blocks, uint64_t *shorts, uint64_t *candidates);
+
+inline bool is_transfer_candidate(uint16_t parcel) {
+    return (parcel & 0x7f) == 0b1101111 || (parcel & 0x7f) == 0b1100011 || (parcel & 0x6003) == 0x2001 || (parcel & 0xc003) == 0xc001;
+}
+
+inline void prescan_scalar(const uint8_t *data, size_t blocks, uint64_t *shorts, uint64_t *candidates) {
+    for (size_t b = 0; b < blocks; b++, data += prescan_block_bytes) {
+        uint64_t short_bits = 0, candidate_bits = 0;
+        for (unsigned i = 0; i < 64; i++) {
+            uint16_t parcel = data[2 * i] | data[2 * i + 1] << 8;
+            short_bits |= (uint64_t)((parcel & 0b11) != 0b11) << i;
+            candidate_bits |= (uint64_t)is_transfer_candidate(parcel) << i;
+        }
+        shorts[b] = short_bits;
+        candidates[b] = candidate_bits;
+    }
+}
+
+#ifdef LAB3_PRESCAN_X86
+// The comparisons are done on 16-bit lanes and packed to bytes with signed saturation (0xffff stays 0xff), so one
+// movemask yields a bit per parcel.
+__attribute__((target("sse2"))) inline void prescan_parcels(__m128i v, __m128i &longs, __m128i &transfers) {
+    const __m128i low2 = _mm_set1_epi16(0b11), low7 = _mm_set1_epi16(0x7f), opcode = _mm_and_si128(v, low7);
+    longs = _mm_cmpeq_epi16(_mm_and_si128(v, low2), low2);
+    transfers = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi16(opcode, _mm_set1_epi16(0b1101111)), _mm_cmpeq_epi16(opcode, _mm_set1_epi16(0b1100011))),
+                             _mm_or_si128(_mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(0x6003)), _mm_set1_epi16(0x2001)),
+                                          _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16((short)0xc003)), _mm_set1_epi16((short)0xc001))));
+}
+
+__attribute__((target("sse2"))) inline void prescan_sse2(const uint8_t *data, size_t blocks, uint64_t *shorts, uint64_t *candidates) {
+    for (size_t b = 0; b < blocks; b++, data += prescan_block_bytes) {
+        uint64_t long_bits = 0, candidate_bits = 0;
+        for (unsigned i = 0; i < 4; i++) {
+            __m128i longs0, longs1, transfers0, transfers1;
+            prescan_parcels(_mm_loadu_si128((const __m128i *)(data + 32 * i)), longs0, transfers0);
+            prescan_parcels(_mm_loadu_si128((const __m128i *)(data + 32 * i + 16)), longs1, transfers1);
+            long_bits |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_packs_epi16(longs0, longs1)) << (16 * i);
+            candidate_bits |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_packs_epi16(transfers0, transfers1)) << (16 * i);
+        }
+        shorts[b] = ~long_bits;
+        candidates[b] = candidate_bits;
+    }
+}
+
+// The same with 16 parcels a vector; packing works within 128-bit lanes, so the quadwords are put back in order
+// before the movemask.
+__attribute__((target("avx2"))) inline void prescan_parcels(__m256i v, __m256i &longs, __m256i &transfers) {
+    const __m256i low2 = _mm256_set1_epi16(0b11), low7 = _mm256_set1_epi16(0x7f), opcode = _mm256_and_si256(v, low7);
+    longs = _mm256_cmpeq_epi16(_mm256_and_si256(v, low2), low2);
+    transfers = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi16(opcode, _mm256_set1_epi16(0b1101111)), _mm256_cmpeq_epi16(opcode, _mm256_set1_epi16(0b1100011))),
+                                _mm256_or_si256(_mm256_cmpeq_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0x6003)), _mm256_set1_epi16(0x2001)),
+                                                _mm256_cmpeq_epi16(_mm256_and_si256(v, _mm256_set1_epi16((short)0xc003)), _mm256_set1_epi16((short)0xc001))));
+}
+
+__attribute__((target("avx2"))) inline void prescan_avx2(const uint8_t *data, size_t blocks, uint64_t *shorts, uint64_t *candidates) {
+    for (size_t b = 0; b < blocks; b++, data += prescan_block_bytes) {
+        uint64_t long_bits = 0, candidate_bits = 0;
+        for (unsigned i = 0; i < 2; i++) {
+            __m256i longs0, longs1, transfers0, transfers1;
+            prescan_parcels(_mm256_loadu_si256((const __m256i *)(data + 64 * i)), longs0, transfers0);
+            prescan_parcels(_mm256_loadu_si256((const __m256i *)(data + 64 * i + 32)), longs1, transfers1);
+            __m256i longs = _mm256_permute4x64_epi64(_mm256_packs_epi16(longs0, longs1), 0b11011000);
+            __m256i transfers = _mm256_permute4x64_epi64(_mm256_packs_epi16(transfers0, transfers1), 0b11011000);
+            long_bits |= (uint64_t)(uint32_t)_mm256_movemask_epi8(longs) << (32 * i);
+            candidate_bits |= (uint64_t)(uint32_t)_mm256_movemask_epi8(transfers) << (32 * i);
+        }
+        shorts[b] = ~long_bits;
+        candidates[b] = candidate_bits;
+    }
+}
+#endif
+
+// The best kernel the CPU supports, picked on the first call.
+inline Prescan_Kernel prescan_kernel() {
+    static const Prescan_Kernel kernel = []() -> Prescan_Kernel {
+#ifdef LAB3_PRESCAN_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return prescan_avx2;
+        if (__builtin_cpu_supports("sse2")) return prescan_sse2;
+#endif
+        return prescan_scalar;
+    }();
+    return kernel;
+}
+
+// The parcels of a block that start instructions, given the parcels that would start a 32-bit one (~shorts).
+// `carry` is 1 if parcel 0 is the upper half of an instruction started in the previous block, and is set the same way
+// for the next block. A parcel is an upper half exactly if it follows a run of 32-bit parcels that begins on an
+// instruction start and has odd length, so the runs are told apart by parity with one addition, without a walk.
+inline uint64_t block_starts(uint64_t longs, uint64_t &carry) {
+    const uint64_t even_bits = 0x5555555555555555ull;
+    longs &= ~carry;
+    uint64_t follows_long = longs << 1 | carry;
+    uint64_t odd_run_starts = longs & ~even_bits & ~follows_long, even_runs;
+    carry = __builtin_add_overflow(odd_run_starts, longs, &even_runs);
+    uint64_t upper_halves = (even_bits ^ (even_runs << 1)) & follows_long;
+    return ~upper_halves;
+}
+
+// Walks the instructions of data[begin, end), with an instruction starting at `begin`, and calls
+// visit_candidate(offset) in order for each one that may be a jump or branch (see is_transfer_candidate). Reads no
+// byte outside [begin, end) itself. Returns where the instruction after the last one started before `end` begins,
+// which is past `end` if that one runs over it.
+template<typename Visit>
+inline size_t scan_starts(const uint8_t *data, size_t begin, size_t end, Visit visit_candidate, Prescan_Kernel kernel = prescan_kernel()) {
+    const size_t batch = 64;
+    uint64_t shorts[batch], candidates[batch], carry = 0;
+    size_t cur = begin;
+    if (begin >= end) return begin;
+    auto visit = [&](uint64_t hits, size_t block) {
+        for (; hits != 0; hits &= hits - 1) visit_candidate(block + 2 * __builtin_ctzll(hits));
+    };
+    while (end - cur >= prescan_block_bytes) {
+        size_t blocks = std::min(batch, (end - cur) / prescan_block_bytes);
+        kernel(data + cur, blocks, shorts, candidates);
+        for (size_t b = 0; b < blocks; b++, cur += prescan_block_bytes) visit(block_starts(~shorts[b], carry) & candidates[b], cur);
+    }
+    if (cur == end) return end + 2 * carry;
+
+    // The rest is scanned as a block padded with zero parcels, which are 16-bit and no candidates; a lone byte at an
+    // odd end counts as a parcel for the walk but is never a candidate.
+    uint8_t tail[prescan_block_bytes] = {};
+    size_t parcels = (end - cur + 1) / 2;
+    memcpy(tail, data + cur, end - cur);
+    kernel(tail, 1, shorts, candidates);
+    uint64_t starts = block_starts(~shorts[0], carry);
+    visit(starts & candidates[0] & ((1ull << (end - cur) / 2) - 1), cur);
+    if (parcels == 64) return cur + prescan_block_bytes + 2 * carry;
+    return cur + 2 * (parcels + ((starts >> parcels) & 1 ? 0 : 1));
+}
+
+// The first instruction start at or after `end` when one starts at `begin`, the same as scan_starts().
+inline size_t skip_instructions(const uint8_t *data, size_t begin, size_t end) {
+    return scan_starts(data, begin, end, [](size_t) {});
+}
+
+#endif //LAB3_PRESCAN_HPP
@@ -0,0 +1,55 @@
+#ifndef LAB3_QUERY_HPP
+#define LAB3_QUERY_HPP
+
+#include "disasm.hpp"
+
+#include <cerrno>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+// An address or size in C notation (0x10074, 66676), up to 64 bits for RV64 code.
+inline uint64_t parse_address(std::string_view arg) {
+    std::string value(arg);
+    char *end;
+    errno = 0;
+    unsigned long long address = strtoull(value.c_str(), &end, 0);
+    if (value.empty() || value[0] == '-' || *end != '\0' || errno == ERANGE) throw std::invalid_argument("Invalid address!");
+    return address;
+}
+
+// Part of .text to list instead of the whole file: --symbol NAME, --range BEGIN:END or --pc ADDRESS [--context BYTES].
+struct Text_Query {
+    std::string symbol;
+    bool has_range = false, has_pc = false;
+    uint64_t begin = 0, end = 0, pc = 0, context = 32;
+
+    bool empty() const {
+        return symbol.empty() && !has_range && !has_pc;
+    }
+};
+
+// Lists only the instructions of `query`. The listing lines are the same as in the full listing (labels included);
+// only the requested window of .text is decoded, from the nearest instruction boundary before it. Addresses wider
+// than those of the ELF class are outside .text.
+template<typename ELF>
+inline void print_query(const Basic_Disassembler<ELF> &disassembler, const Text_Query &query, Output_Buffer &output, Output_Format format = FORMAT_TEXT) {
+    using Address = typename ELF::Address;
+    uint64_t begin, end;
+    if (!query.symbol.empty()) {
+        const typename Basic_Symbol_Index<Address>::Interval *symbol = disassembler.symbols().find(query.symbol);
+        if (symbol == nullptr) throw std::invalid_argument("Unknown symbol!");
+        begin = symbol->begin;
+        end = symbol->end;
+    } else if (query.has_range) {
+        begin = query.begin;
+        end = query.end;
+    } else {
+        begin = (query.pc - disassembler.text_address() > query.context ? query.pc - query.context : disassembler.text_address());
+        end = (query.pc + query.context + 1 > query.pc ? query.pc + query.context + 1 : UINT64_MAX);
+    }
+    if (begin > std::numeric_limits<Address>::max() || !disassembler.contains(begin)) throw std::invalid_argument("Address outside .text!");
+    disassembler.print_range(disassembler.boundary_before(begin), (Address)std::min<uint64_t>(end, std::numeric_limits<Address>::max()), output, format);
+}
+
+#endif //LAB3_QUERY_HPP
@@ -1,206 +1,343 @@
 #ifndef LAB3_RV32IM_HPP
 #define LAB3_RV32IM_HPP
 
-#include <iostream>
+#include "elf.hpp"
+#include "insn.hpp"
 
-std::string get_register(uint8_t reg) {
-    static std::string regs[32] = {"zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"};
-    return regs[reg];
-}
+#include <array>
+#include <cstdint>
 
-uint8_t get_rd(uint32_t command) {
+inline uint8_t get_rd(uint32_t command) {
     return (command >> 7) & 0b11111;
 }
 
-uint8_t get_func3(uint32_t command) {
+inline uint8_t get_func3(uint32_t command) {
     return (command >> 12) & 0b111;
 }
 
-uint8_t get_rs1(uint32_t command) {
+inline uint8_t get_rs1(uint32_t command) {
     return (command >> 15) & 0b11111;
 }
 
-uint8_t get_rs2(uint32_t command) {
+inline uint8_t get_rs2(uint32_t command) {
     return (command >> 20) & 0b11111;
 }
 
-uint8_t get_func7(uint32_t command) {
+inline uint8_t get_func7(uint32_t command) {
     return (command >> 25);
 }
 
-uint8_t get_func5(uint32_t command) {
+inline uint8_t get_func5(uint32_t command) {
     return (command >> 27);
 }
 
-uint8_t get_func2(uint32_t command) {
+inline uint8_t get_func2(uint32_t command) {
     return ((command >> 25) & 0b11);
 }
 
-int16_t get_shamt(uint32_t command) {
+inline int16_t get_shamt(uint32_t command) {
     return (command >> 20) & 0b11111;
 }
 
-uint8_t get_opcode(uint32_t command) {
+// RV64 shift amounts have six bits; the funct7 of the shifts shrinks to funct6.
+inline int16_t get_shamt64(uint32_t command) {
+    return (command >> 20) & 0b111111;
+}
+
+inline uint8_t get_func6(uint32_t command) {
+    return (command >> 26);
+}
+
+inline uint8_t get_opcode(uint32_t command) {
     return (command & 0x7f);
 }
 
-bool type_u(uint32_t command, uint32_t cur_address, const std::string &mark, FILE *output_file) {
-    std::string op;
-    int32_t offset = (command & 0xfffff000);
-    uint8_t rd = get_rd(command);
-    if (get_opcode(command) == 0b0110111) op = "lui";
-    if (get_opcode(command) == 0b0010111) op = "auipc";
-    if (op.empty()) return false;
-    fprintf(output_file, "%08x %10s: %s %s, %d\n", cur_address, mark.c_str(), op.c_str(), get_register(rd).c_str(), offset);
-    return true;
+enum Rv32_Format : uint8_t {
+    FORMAT_UNKNOWN,
+    FORMAT_U,
+    FORMAT_UJ,
+    FORMAT_I_LOAD,
+    FORMAT_I_JALR,
+    FORMAT_I,
+    FORMAT_SB,
+    FORMAT_S,
+    FORMAT_R,
+    FORMAT_I_32,   // RV64 OP-IMM-32: addiw, slliw, srliw, sraiw
+    FORMAT_R_32    // RV64 OP-32: addw, subw, ..., remuw
+    // The formats of the opcodes of the other extensions follow in rvext.hpp.
+};
+
+constexpr std::array<uint8_t, 128> make_rv32_formats() {
+    std::array<uint8_t, 128> formats{};
+    formats[0b0110111] = FORMAT_U;
+    formats[0b0010111] = FORMAT_U;
+    formats[0b1101111] = FORMAT_UJ;
+    formats[0b0000011] = FORMAT_I_LOAD;
+    formats[0b1100111] = FORMAT_I_JALR;
+    formats[0b0010011] = FORMAT_I;
+    formats[0b1100011] = FORMAT_SB;
+    formats[0b0100011] = FORMAT_S;
+    formats[0b0110011] = FORMAT_R;
+    return formats;
 }
 
-bool type_uj(uint32_t command, uint32_t cur_address, const std::string &mark, const std::string &mark_offset, FILE *output_file) {
-    std::string op;
-    uint32_t offset = (((command >> 31) & 0b1) << 20) + (((command >> 12) & 0xff) << 12) + (((command >> 20) & 0b1) << 11) + (((command >> 21) & 0x3ff) << 1);
-    if ((offset & (1 << 20)) != 0) {
-        offset = (offset | 0xffe00000);
+constexpr std::array<uint8_t, 128> make_rv64_formats() {
+    std::array<uint8_t, 128> formats = make_rv32_formats();
+    formats[0b0011011] = FORMAT_I_32;
+    formats[0b0111011] = FORMAT_R_32;
+    return formats;
+}
+
+constexpr std::array<uint8_t, 128> make_rv32_rows() {
+    std::array<uint8_t, 128> rows{};
+    for (auto &row : rows) row = 3;
+    rows[0b0000000] = 0;
+    rows[0b0100000] = 1;
+    rows[0b0000001] = 2;
+    // Zba, Zbb and Zbs
+    rows[0b0000100] = 4;
+    rows[0b0000101] = 5;
+    rows[0b0010000] = 6;
+    rows[0b0110000] = 7;
+    rows[0b0100100] = 8;
+    rows[0b0110100] = 9;
+    rows[0b0010100] = 10;
+    return rows;
+}
+
+// Row of the funct7-dependent tables below by funct7; row 3 holds no instructions.
+constexpr std::array<uint8_t, 128> rv32_rows = make_rv32_rows();
+const size_t rv32_rows_count = 11;
+
+constexpr uint8_t load_ops[8] = {MN_LB, MN_LH, MN_LW, MN_UNKNOWN, MN_LBU, MN_LHU, MN_UNKNOWN, MN_UNKNOWN};
+constexpr uint8_t load_ops64[8] = {MN_LB, MN_LH, MN_LW, MN_LD, MN_LBU, MN_LHU, MN_LWU, MN_UNKNOWN};
+constexpr uint8_t alu_imm_ops[8] = {MN_ADDI, MN_UNKNOWN, MN_SLTI, MN_SLTIU, MN_XORI, MN_UNKNOWN, MN_ORI, MN_ANDI};
+// MN_CLZ, MN_REV8 and MN_ORC_B stand for the Zbb operations on rs1 alone, which type_unary() tells apart.
+constexpr uint8_t shift_imm_ops[rv32_rows_count][8] = {
+        {MN_UNKNOWN, MN_SLLI, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_SRLI, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_SRAI, MN_UNKNOWN, MN_UNKNOWN},
+        {},
+        {},
+        {},
+        {},
+        {},
+        {MN_UNKNOWN, MN_CLZ, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_RORI, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_UNKNOWN, MN_BCLRI, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_BEXTI, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_UNKNOWN, MN_BINVI, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_REV8, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_UNKNOWN, MN_BSETI, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_ORC_B, MN_UNKNOWN, MN_UNKNOWN}
+};
+constexpr uint8_t branch_ops[8] = {MN_BEQ, MN_BNE, MN_UNKNOWN, MN_UNKNOWN, MN_BLT, MN_BGE, MN_BLTU, MN_BGEU};
+constexpr uint8_t store_ops[8] = {MN_SB, MN_SH, MN_SW, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN};
+constexpr uint8_t store_ops64[8] = {MN_SB, MN_SH, MN_SW, MN_SD, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN};
+// MN_ZEXT_H is RV32 zext.h, which needs rs2 = 0.
+constexpr uint8_t r_ops[rv32_rows_count][8] = {
+        {MN_ADD, MN_SLL, MN_SLT, MN_SLTU, MN_XOR, MN_SRL, MN_OR, MN_AND},
+        {MN_SUB, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_XNOR, MN_SRA, MN_ORN, MN_ANDN},
+        {MN_MUL, MN_MULH, MN_MULHSU, MN_MULHU, MN_DIV, MN_DIVU, MN_REM, MN_REMU},
+        {},
+        {MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_ZEXT_H, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_MIN, MN_MINU, MN_MAX, MN_MAXU},
+        {MN_UNKNOWN, MN_UNKNOWN, MN_SH1ADD, MN_UNKNOWN, MN_SH2ADD, MN_UNKNOWN, MN_SH3ADD, MN_UNKNOWN},
+        {MN_UNKNOWN, MN_ROL, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_ROR, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_UNKNOWN, MN_BCLR, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_BEXT, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_UNKNOWN, MN_BINV, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_UNKNOWN, MN_BSET, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN}
+};
+// addiw does not depend on funct7; slli.uw has a 6-bit shift amount, so it takes the rows of both funct7 values.
+constexpr uint8_t alu_imm32_ops[rv32_rows_count][8] = {
+        {MN_ADDIW, MN_SLLIW, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_SRLIW, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_ADDIW, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_SRAIW, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_ADDIW},
+        {MN_ADDIW},
+        {MN_ADDIW, MN_SLLI_UW},
+        {MN_ADDIW, MN_SLLI_UW},
+        {MN_ADDIW},
+        {MN_ADDIW, MN_CLZW, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_RORIW, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_ADDIW},
+        {MN_ADDIW},
+        {MN_ADDIW}
+};
+constexpr uint8_t r32_ops[rv32_rows_count][8] = {
+        {MN_ADDW, MN_SLLW, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_SRLW, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_SUBW, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_SRAW, MN_UNKNOWN, MN_UNKNOWN},
+        {MN_MULW, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_DIVW, MN_DIVUW, MN_REMW, MN_REMUW},
+        {},
+        {MN_ADD_UW, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_ZEXT_H, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN},
+        {},
+        {MN_UNKNOWN, MN_UNKNOWN, MN_SH1ADD_UW, MN_UNKNOWN, MN_SH2ADD_UW, MN_UNKNOWN, MN_SH3ADD_UW, MN_UNKNOWN},
+        {MN_UNKNOWN, MN_ROLW, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_RORW, MN_UNKNOWN, MN_UNKNOWN},
+        {},
+        {},
+        {}
+};
+// clz, ctz, cpop, sext.b and sext.h by the rs2 field, and their RV64 *w forms.
+constexpr uint8_t count_ops[8] = {MN_CLZ, MN_CTZ, MN_CPOP, MN_UNKNOWN, MN_SEXT_B, MN_SEXT_H, MN_UNKNOWN, MN_UNKNOWN};
+constexpr uint8_t count_ops32[8] = {MN_CLZW, MN_CTZW, MN_CPOPW, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN};
+
+inline int16_t get_imm_i(uint32_t command) {
+    int16_t imm = command >> 20;
+    if ((imm & (1 << 11)) != 0) {
+        imm = (imm | 0xf000);
     }
-    uint8_t rd = get_rd(command);
-    if (get_opcode(command) == 0b1101111) op = "jal";
-    if (op.empty()) return false;
-    fprintf(output_file, "%08x %10s: %s %s, %s\n", cur_address, mark.c_str(), op.c_str(), get_register(rd).c_str(), mark_offset.c_str());
-    return true;
+    return imm;
 }
 
-bool type_i(uint32_t command, uint32_t cur_address, const std::string &mark, const std::string &mark_offset, FILE *output_file) {
-    std::string op;
-    int16_t offset = command >> 20;
+inline int16_t get_imm_s(uint32_t command) {
+    int16_t offset = ((command >> 25) << 5) + ((command >> 7) & 31);
     if ((offset & (1 << 11)) != 0) {
         offset = (offset | 0xf000);
     }
-    if (get_opcode(command) == 0b0000011) {
-        uint8_t rs1 = get_rs1(command), func3 = get_func3(command), rd = get_rd(command);
-        if (func3 == 0b000) op = "lb";
-        if (func3 == 0b001) op = "lh";
-        if (func3 == 0b010) op = "lw";
-        if (func3 == 0b100) op = "lbu";
-        if (func3 == 0b101) op = "lhu";
-        if (op.empty()) return false;
-        fprintf(output_file, "%08x %10s: %s %s, %d(%s)\n", cur_address, mark.c_str(), op.c_str(), get_register(rd).c_str(), offset, get_register(rs1).c_str());
-        return true;
-    }
-    uint8_t rs1 = get_rs1(command), func3 = get_func3(command), rd = get_rd(command);
-    if (get_opcode(command) == 0b1100111) {
-        if (func3 == 0b000) op = "jalr"; else return false;
-        fprintf(output_file, "%08x %10s: %s %s, %s, %d\n", cur_address, mark.c_str(), op.c_str(), get_register(rd).c_str(), get_register(rs1).c_str(), offset);
-        return true;
+    return offset;
+}
+
+template<typename Insn>
+inline void type_u(uint32_t command, Insn &insn) {
+    insn.mnemonic = (get_opcode(command) == 0b0110111 ? MN_LUI : MN_AUIPC);
+    insn.operands = OPERANDS_RD_IMM;
+    insn.rd = get_rd(command);
+    insn.imm = (command & 0xfffff000);
+}
+
+template<typename Insn>
+inline void type_uj(uint32_t command, Insn &insn) {
+    int32_t offset = (((command >> 31) & 0b1) << 20) + (((command >> 12) & 0xff) << 12) + (((command >> 20) & 0b1) << 11) + (((command >> 21) & 0x3ff) << 1);
+    if ((offset & (1 << 20)) != 0) {
+        offset = (offset | 0xffe00000);
     }
-    if (get_opcode(command) == 0b0010011) {
-        int16_t imm = command >> 20;
-        if ((imm & (1 << 11)) != 0) {
-            imm = (imm | 0xf000);
-        }
-        if (func3 == 0b000) op = "addi";
-        if (func3 == 0b010) op = "slti";
-        if (func3 == 0b011) op = "sltiu";
-        if (func3 == 0b100) op = "xori";
-        if (func3 == 0b110) op = "ori";
-        if (func3 == 0b111) op = "andi";
-        if (func3 == 0b001 && get_func7(command) == 0b0000000) {
-            imm = get_shamt(command);
-            op = "slli";
-        }
-        if (func3 == 0b101) {
-            imm = get_shamt(command);
-            uint8_t func7 = get_func7(command);
-            if (func7 == 0b0000000) op = "srli";
-            if (func7 == 0b0100000) op = "srai";
-        }
-        if (op.empty()) return false;
-        fprintf(output_file, "%08x %10s: %s %s, %s, %d\n", cur_address, mark.c_str(), op.c_str(), get_register(rd).c_str(), get_register(rs1).c_str(), imm);
-        return true;
+    insn.mnemonic = MN_JAL;
+    insn.operands = OPERANDS_RD_LABEL;
+    insn.rd = get_rd(command);
+    insn.imm = offset;
+    insn.target = insn.address + offset;
+    insn.has_target = 1;
+}
+
+template<typename ELF>
+inline void type_i_load(uint32_t command, Basic_Insn<typename ELF::Address> &insn) {
+    insn.mnemonic = (ELF::xlen == 64 ? load_ops64 : load_ops)[get_func3(command)];
+    if (insn.mnemonic == MN_UNKNOWN) return;
+    insn.operands = OPERANDS_RD_IMM_RS1;
+    insn.rd = get_rd(command);
+    insn.rs1 = get_rs1(command);
+    insn.imm = get_imm_i(command);
+}
+
+template<typename Insn>
+inline void type_i_jalr(uint32_t command, Insn &insn) {
+    if (get_func3(command) != 0b000) return;
+    insn.mnemonic = MN_JALR;
+    insn.operands = OPERANDS_RD_RS1_IMM;
+    insn.rd = get_rd(command);
+    insn.rs1 = get_rs1(command);
+    insn.imm = get_imm_i(command);
+}
+
+// The Zbb operations on rs1 alone, which the tables above only narrow down to MN_CLZ, MN_CLZW, MN_REV8, MN_ORC_B or
+// MN_ZEXT_H; the rest of the immediate (or rs2) tells them apart, and is different for rev8 and zext.h on RV64.
+template<typename ELF>
+inline void type_unary(uint32_t command, Basic_Insn<typename ELF::Address> &insn) {
+    uint16_t imm = command >> 20;
+    switch (insn.mnemonic) {
+        case MN_CLZ: insn.mnemonic = ((imm >> 3) == (0x600 >> 3) ? count_ops[imm & 0b111] : (uint8_t)MN_UNKNOWN); break;
+        case MN_CLZW: insn.mnemonic = ((imm >> 3) == (0x600 >> 3) ? count_ops32[imm & 0b111] : (uint8_t)MN_UNKNOWN); break;
+        case MN_REV8: if (imm != (ELF::xlen == 64 ? 0x6b8 : 0x698)) insn.mnemonic = MN_UNKNOWN; break;
+        case MN_ORC_B: if (imm != 0x287) insn.mnemonic = MN_UNKNOWN; break;
+        // RV32 OP or RV64 OP-32
+        case MN_ZEXT_H: if (get_rs2(command) != 0 || (get_opcode(command) == 0b0110011) != (ELF::xlen == 32)) insn.mnemonic = MN_UNKNOWN; break;
+        default: break;
     }
-    return false;
-}
-
-bool type_sb(uint32_t command, uint32_t cur_address, const std::string &mark, const std::string &mark_offset, FILE *output_file) {
-    if (get_opcode(command) == 0b1100011) {
-        std::string op;
-        int16_t offset = (((command >> 31) & 0b1) << 12) + (((command >> 7) & 0b1) << 11) + (((command >> 25) & 0b111111) << 5) + (((command >> 8) & 0b1111) << 1);
-        if ((offset & (1 << 12)) != 0) {
-            offset = (offset | 0xe000);
-        }
-        uint8_t rs2 = get_rs2(command), rs1 = get_rs1(command), func3 = get_func3(command);
-        if (func3 == 0b000) op = "beq";
-        if (func3 == 0b001) op = "bne";
-        if (func3 == 0b100) op = "blt";
-        if (func3 == 0b101) op = "bge";
-        if (func3 == 0b110) op = "bltu";
-        if (func3 == 0b111) op = "bgeu";
-        if (op.empty()) return false;
-        fprintf(output_file, "%08x %10s: %s %s, %s, %s\n", cur_address, mark.c_str(), op.c_str(), get_register(rs1).c_str(), get_register(rs2).c_str(), mark_offset.c_str());
-        return true;
+    if (insn.mnemonic == MN_UNKNOWN) return;
+    insn.operands = OPERANDS_RD_RS1;
+    insn.rd = get_rd(command);
+    insn.rs1 = get_rs1(command);
+}
+
+inline bool is_unary(uint8_t mnemonic) {
+    return mnemonic >= MN_CLZ && mnemonic <= MN_ZEXT_H;
+}
+
+template<typename ELF>
+inline void type_i(uint32_t command, Basic_Insn<typename ELF::Address> &insn) {
+    uint8_t func3 = get_func3(command);
+    if ((func3 == 0b001 || func3 == 0b101) && ELF::xlen == 64) {
+        insn.mnemonic = shift_imm_ops[rv32_rows[get_func6(command) << 1]][func3];
+        insn.imm = get_shamt64(command);
+    } else if (func3 == 0b001 || func3 == 0b101) {
+        insn.mnemonic = shift_imm_ops[rv32_rows[get_func7(command)]][func3];
+        insn.imm = get_shamt(command);
+    } else {
+        insn.mnemonic = alu_imm_ops[func3];
+        insn.imm = get_imm_i(command);
     }
-    return false;
-}
-
-bool type_s(uint32_t command, uint32_t cur_address, const std::string &mark, FILE *output_file) {
-    if (get_opcode(command) == 0b0100011) {
-        std::string op;
-        int16_t offset = ((command >> 25) << 5) + ((command >> 7) & 31);
-        if ((offset & (1 << 11)) != 0) {
-            offset = (offset | 0xf000);
-        }
-        uint8_t rs2 = get_rs2(command), rs1 = get_rs1(command), func3 = get_func3(command);
-        if (func3 == 0b000) op = "sb";
-        if (func3 == 0b001) op = "sh";
-        if (func3 == 0b010) op = "sw";
-        if (op.empty()) return false;
-        fprintf(output_file, "%08x %10s: %s %s, %d(%s)\n", cur_address, mark.c_str(), op.c_str(), get_register(rs2).c_str(), offset, get_register(rs1).c_str());
-        return true;
+    if (insn.mnemonic == MN_UNKNOWN || is_unary(insn.mnemonic)) {
+        insn.imm = 0;
+        if (insn.mnemonic != MN_UNKNOWN) type_unary<ELF>(command, insn);
+        return;
     }
-    return false;
-}
-
-bool type_r(uint32_t command, uint32_t cur_address, const std::string &mark, FILE *output_file) {
-    if (get_opcode(command) == 0b0110011) {
-        std::string op;
-        uint8_t func5 = get_func5(command), func2 = get_func2(command), rs2 = get_rs2(command), rs1 = get_rs1(command), func3 = get_func3(command), rd = get_rd(command);
-        if (func5 == 0b00000 && func2 == 0b00) {
-            if (func3 == 0b000) op = "add";
-            if (func3 == 0b001) op = "sll";
-            if (func3 == 0b010) op = "slt";
-            if (func3 == 0b011) op = "sltu";
-            if (func3 == 0b100) op = "xor";
-            if (func3 == 0b101) op = "srl";
-            if (func3 == 0b110) op = "or";
-            if (func3 == 0b111) op = "and";
-        }
-        if (func5 == 0b01000 && func2 == 0b00) {
-            if (func3 == 0b000) op = "sub";
-            if (func3 == 0b101) op = "sra";
-        }
-        if (func5 == 0b00000 && func2 == 0b01) {
-            if (func3 == 0b000) op = "mul";
-            if (func3 == 0b001) op = "mulh";
-            if (func3 == 0b010) op = "mulhsu";
-            if (func3 == 0b011) op = "mulhu";
-            if (func3 == 0b100) op = "div";
-            if (func3 == 0b101) op = "divu";
-            if (func3 == 0b110) op = "rem";
-            if (func3 == 0b111) op = "remu";
-        }
-        if (op.empty()) return false;
-        fprintf(output_file, "%08x %10s: %s %s, %s, %s\n", cur_address, mark.c_str(), op.c_str(), get_register(rd).c_str(), get_register(rs1).c_str(), get_register(rs2).c_str());
-        return true;
+    insn.operands = OPERANDS_RD_RS1_IMM;
+    insn.rd = get_rd(command);
+    insn.rs1 = get_rs1(command);
+}
+
+template<typename Insn>
+inline void type_sb(uint32_t command, Insn &insn) {
+    int16_t offset = (((command >> 31) & 0b1) << 12) + (((command >> 7) & 0b1) << 11) + (((command >> 25) & 0b111111) << 5) + (((command >> 8) & 0b1111) << 1);
+    if ((offset & (1 << 12)) != 0) {
+        offset = (offset | 0xe000);
     }
-    return false;
+    insn.target = insn.address + offset;
+    insn.has_target = 1;
+    insn.mnemonic = branch_ops[get_func3(command)];
+    if (insn.mnemonic == MN_UNKNOWN) return;
+    insn.operands = OPERANDS_RS1_RS2_LABEL;
+    insn.rs1 = get_rs1(command);
+    insn.rs2 = get_rs2(command);
+    insn.imm = offset;
+}
+
+template<typename ELF>
+inline void type_s(uint32_t command, Basic_Insn<typename ELF::Address> &insn) {
+    insn.mnemonic = (ELF::xlen == 64 ? store_ops64 : store_ops)[get_func3(command)];
+    if (insn.mnemonic == MN_UNKNOWN) return;
+    insn.operands = OPERANDS_RS2_IMM_RS1;
+    insn.rs1 = get_rs1(command);
+    insn.rs2 = get_rs2(command);
+    insn.imm = get_imm_s(command);
+}
+
+template<typename ELF>
+inline void type_r(uint32_t command, Basic_Insn<typename ELF::Address> &insn) {
+    insn.mnemonic = r_ops[rv32_rows[get_func7(command)]][get_func3(command)];
+    if (insn.mnemonic == MN_UNKNOWN) return;
+    if (insn.mnemonic == MN_ZEXT_H) return type_unary<ELF>(command, insn);
+    insn.operands = OPERANDS_RD_RS1_RS2;
+    insn.rd = get_rd(command);
+    insn.rs1 = get_rs1(command);
+    insn.rs2 = get_rs2(command);
+}
+
+// RV64 addiw and the 32-bit shifts, whose shamt keeps five bits but for slli.uw.
+template<typename ELF>
+inline void type_i_32(uint32_t command, Basic_Insn<typename ELF::Address> &insn) {
+    uint8_t func3 = get_func3(command);
+    insn.mnemonic = alu_imm32_ops[rv32_rows[get_func7(command)]][func3];
+    if (insn.mnemonic == MN_UNKNOWN) return;
+    if (insn.mnemonic == MN_CLZW) return type_unary<ELF>(command, insn);
+    insn.operands = OPERANDS_RD_RS1_IMM;
+    insn.rd = get_rd(command);
+    insn.rs1 = get_rs1(command);
+    insn.imm = (func3 == 0b000 ? get_imm_i(command) : insn.mnemonic == MN_SLLI_UW ? get_shamt64(command) : get_shamt(command));
 }
 
-void rv32im(uint32_t command, uint32_t cur_address, const std::string &mark, const std::string &mark_offset, FILE *output_file) {
-    if (type_u(command, cur_address, mark, output_file)) return;
-    if (type_uj(command, cur_address, mark, mark_offset, output_file)) return;
-    if (type_i(command, cur_address, mark, mark_offset, output_file)) return;
-    if (type_sb(command, cur_address, mark, mark_offset, output_file)) return;
-    if (type_s(command, cur_address, mark, output_file)) return;
-    if (type_r(command, cur_address, mark, output_file)) return;
-    fprintf(output_file, "%08x %10s: %s\n", cur_address, mark.c_str(), "unknown_command");
+template<typename ELF>
+inline void type_r_32(uint32_t command, Basic_Insn<typename ELF::Address> &insn) {
+    insn.mnemonic = r32_ops[rv32_rows[get_func7(command)]][get_func3(command)];
+    if (insn.mnemonic == MN_UNKNOWN) return;
+    if (insn.mnemonic == MN_ZEXT_H) return type_unary<ELF>(command, insn);
+    insn.operands = OPERANDS_RD_RS1_RS2;
+    insn.rd = get_rd(command);
+    insn.rs1 = get_rs1(command);
+    insn.rs2 = get_rs2(command);
 }
 
 #endif //LAB3_RV32IM_HPP
@@ -1,274 +1,351 @@
 #ifndef LAB3_RVC_HPP
 #define LAB3_RVC_HPP
 
-#include <iostream>
+#include "elf.hpp"
+#include "insn.hpp"
 
-std::string get_reg(uint8_t reg) {
-    static std::string regs[32] = {"zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2", "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5", "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"};
-    return regs[reg];
-}
-
-std::string get_reg_(uint8_t reg) {
-    static std::string regs[8] = {"s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5"};
-    return regs[reg];
-}
+#include <array>
+#include <cstdint>
 
-uint8_t get_opcode(uint16_t command) {
+inline uint8_t get_opcode(uint16_t command) {
     return (command & 0b11);
 }
 
-uint8_t get_funct3(uint16_t command) {
+inline uint8_t get_funct3(uint16_t command) {
     return (command >> 13);
 }
 
-uint8_t get_rd(uint16_t command) {
+inline uint8_t get_rd(uint16_t command) {
     return ((command >> 7) & 0b11111);
 }
 
-uint8_t get_rs2(uint16_t command) {
+inline uint8_t get_rs2(uint16_t command) {
     return ((command >> 2) & 0b11111);
 }
 
-uint8_t get_rs1(uint16_t command) {
+inline uint8_t get_rs1(uint16_t command) {
     return ((command >> 7) & 0b11111);
 }
 
-uint8_t get_rd_(uint16_t command) {
+inline uint8_t get_rd_(uint16_t command) {
     return ((command >> 2) & 0b111);
 }
 
-uint8_t get_rs2_(uint16_t command) {
+inline uint8_t get_rs2_(uint16_t command) {
     return ((command >> 2) & 0b111);
 }
 
-uint8_t get_rs1_(uint16_t command) {
+inline uint8_t get_rs1_(uint16_t command) {
     return ((command >> 7) & 0b111);
 }
 
-uint8_t get_imm3(uint16_t command) {
+inline uint8_t get_imm3(uint16_t command) {
     return ((command >> 10) & 0b111);
 }
 
-uint8_t get_imm2(uint16_t command) {
+inline uint8_t get_imm2(uint16_t command) {
     return ((command >> 5) & 0b11);
 }
 
-bool type_ciw(uint16_t command, uint32_t cur_address, const std::string &mark, FILE *output_file) {
-    if (get_opcode(command) == 0b00) {
-        if (get_funct3(command) == 0b000) {
-            uint8_t rd_ = get_rd_(command);
-            uint16_t imm = (((command >> 7) & 0b1111) << 6) + (((command >> 11) & 0b11) << 4) + (((command >> 5) & 0b1) << 3) + (((command >> 6) & 0b1) << 2);
-            if (imm != 0) {
-                fprintf(output_file, "%08x %10s: %s %s, %s, %d\n", cur_address, mark.c_str(), "c.addi4spn", get_reg_(rd_).c_str(), "sp", imm);
-                return true;
-            }
-        }
+constexpr int8_t get_ci_imm(uint16_t command) {
+    int8_t imm = (((command >> 12) & 0b1) << 5) + ((command >> 2) & 0b11111);
+    if ((imm & (1 << 5)) != 0) {
+        imm = (imm | 0xc0);
     }
-    return false;
+    return imm;
 }
 
-bool type_cl(uint16_t command, uint32_t cur_address, const std::string &mark, FILE *output_file) {
-    if (get_opcode(command) == 0b00) {
-        if (get_funct3(command) == 0b010) {
-            uint8_t rd_ = get_rd_(command), rs1_ = get_rs1_(command), offset = (((command >> 5) & 0b1) << 6) + (((command >> 10) & 0b111) << 3) + (((command >> 6) & 0b1) << 2);
-            fprintf(output_file, "%08x %10s: %s %s, %d(%s)\n", cur_address, mark.c_str(), "c.lw", get_reg_(rd_).c_str(), offset, get_reg_(rs1_).c_str());
-            return true;
-        }
-        if (get_funct3(command) == 0b110) {
-            uint8_t rs2_ = get_rs2_(command), rs1_ = get_rs1_(command), offset = (((command >> 5) & 0b1) << 6) + (((command >> 10) & 0b111) << 3) + (((command >> 6) & 0b1) << 2);
-            fprintf(output_file, "%08x %10s: %s %s, %d(%s)\n", cur_address, mark.c_str(), "c.sw", get_reg_(rs2_).c_str(), offset, get_reg_(rs1_).c_str());
-            return true;
-        }
-    }
-    return false;
+constexpr int32_t get_lui_imm(uint16_t command) {
+    int32_t imm = (((command >> 12) & 0b1) << 17) + (((command >> 2) & 0b11111) << 12);
+    if ((imm & (1 << 17)) != 0) imm = (imm | 0xfffc0000);
+    return imm;
 }
 
-bool type_cs(uint16_t command, uint32_t cur_address, const std::string &mark, FILE *output_file) {
-    if (get_opcode(command) == 0b01) {
-        if (get_funct3(command) == 0b100) {
-            std::string op;
-            uint8_t rs1_ = get_rs1_(command), rs2_ = get_rs2_(command);
-            if (get_imm3(command) == 0b011 && get_imm2(command) == 0b00) op = "c.sub";
-            if (get_imm3(command) == 0b011 && get_imm2(command) == 0b01) op = "c.xor";
-            if (get_imm3(command) == 0b011 && get_imm2(command) == 0b10) op = "c.or";
-            if (get_imm3(command) == 0b011 && get_imm2(command) == 0b11) op = "c.and";
-            if (!op.empty()) {
-                fprintf(output_file, "%08x %10s: %s %s, %s\n", cur_address, mark.c_str(), op.c_str(), get_reg_(rs1_).c_str(), get_reg_(rs2_).c_str());
-                return true;
-            }
-        }
-    }
-    return false;
+constexpr int16_t get_addi16sp_imm(uint16_t command) {
+    int16_t imm = (((command >> 12) & 0b1) << 9) + (((command >> 3) & 0b11) << 7) + (((command >> 5) & 0b1) << 6) + (((command >> 2) & 0b1) << 5) + (((command >> 6) & 0b1) << 4);
+    if ((imm & (1 << 9)) != 0) imm = (imm | 0xfc00);
+    return imm;
+}
+
+constexpr uint16_t get_addi4spn_imm(uint16_t command) {
+    return (((command >> 7) & 0b1111) << 6) + (((command >> 11) & 0b11) << 4) + (((command >> 5) & 0b1) << 3) + (((command >> 6) & 0b1) << 2);
 }
 
-bool type_ci(uint16_t command, uint32_t cur_address, const std::string &mark, FILE *output_file) {
-    if (command == 0x0001) {
-        fprintf(output_file, "%08x %10s: %s\n", cur_address, mark.c_str(), "c.nop");
-        return true;
+// The 6-bit shift amount of RV64 c.slli, c.srli and c.srai.
+constexpr uint8_t get_c_shamt64(uint16_t command) {
+    return (((command >> 12) & 0b1) << 5) + ((command >> 2) & 0b11111);
+}
+
+// Mnemonic of a 16-bit parcel; encodings are checked in the same order as the type_c* probes used to be. RV64 code
+// (xlen 64) reuses some RV32 encodings: c.ld, c.sd, c.ldsp and c.sdsp take the place of c.flw, c.fsw, c.flwsp and
+// c.fswsp, c.addiw that of c.jal, and the shifts take a 6-bit shift amount. The float loads and stores are in the
+// table whatever the extensions; decode_insn() drops them from files without F or D.
+template<unsigned xlen>
+constexpr uint8_t classify_rvc(uint16_t command) {
+    uint8_t opcode = command & 0b11, funct3 = command >> 13, rd = (command >> 7) & 0b11111, rs2 = (command >> 2) & 0b11111;
+    if (opcode == 0b00) {
+        if (funct3 == 0b000 && get_addi4spn_imm(command) != 0) return MN_C_ADDI4SPN;
+        if (funct3 == 0b010) return MN_C_LW;
+        if (funct3 == 0b110) return MN_C_SW;
+        if (xlen == 64 && funct3 == 0b011) return MN_C_LD;
+        if (xlen == 64 && funct3 == 0b111) return MN_C_SD;
+        if (funct3 == 0b001) return MN_C_FLD;
+        if (funct3 == 0b101) return MN_C_FSD;
+        if (funct3 == 0b011) return MN_C_FLW;
+        if (funct3 == 0b111) return MN_C_FSW;
+        return MN_UNKNOWN;
     }
-    if (get_opcode(command) == 0b01) {
-        uint8_t rd = get_rd(command);
-        if (get_funct3(command) == 0b000) {
-            int8_t imm = (((command >> 12) & 0b1) << 5) + ((command >> 2) & 0b11111);
-            if ((imm & (1 << 5)) != 0) {
-                imm = (imm | 0xc0);
-            }
-            if (rd != 0 && imm != 0) {
-                fprintf(output_file, "%08x %10s: %s %s, %s, %d\n", cur_address, mark.c_str(), "c.addi", get_reg(rd).c_str(), get_reg(rd).c_str(), imm);
-                return true;
-            }
-        }
-        if (get_funct3(command) == 0b010) {
-            int8_t imm = (((command >> 12) & 0b1) << 5) + ((command >> 2) & 0b11111);
-            if ((imm & (1 << 5)) != 0) {
-                imm = (imm | 0xc0);
-            }
-            if (rd != 0) {
-                fprintf(output_file, "%08x %10s: %s %s, %d\n", cur_address, mark.c_str(), "c.li", get_reg(rd).c_str(), imm);
-                return true;
-            }
+    if (opcode == 0b01) {
+        if (funct3 == 0b100 && ((command >> 10) & 0b111) == 0b011) {
+            constexpr uint8_t ops[4] = {MN_C_SUB, MN_C_XOR, MN_C_OR, MN_C_AND};
+            return ops[(command >> 5) & 0b11];
         }
-        if (get_funct3(command) == 0b011) {
-            int32_t imm = (((command >> 12) & 0b1) << 17) + (((command >> 2) & 0b11111) << 12);
-            int16_t imm_ = (((command >> 12) & 0b1) << 9) + (((command >> 3) & 0b11) << 7) + (((command >> 5) & 0b1) << 6) + (((command >> 2) & 0b1) << 5) + (((command >> 6) & 0b1) << 4);
-            if ((imm & (1 << 17)) != 0) imm = (imm | 0xfffc0000);
-            if ((imm_ & (1 << 9)) != 0) imm_ = (imm_ | 0xfc00);
-            if (rd != 0 && rd != 2 && imm != 0) {
-                fprintf(output_file, "%08x %10s: %s %s, %d\n", cur_address, mark.c_str(), "c.lui", get_reg(rd).c_str(), imm);
-                return true;
-            }
-            if (rd == 2 && imm_ != 0) {
-                fprintf(output_file, "%08x %10s: %s %s, %s, %d\n", cur_address, mark.c_str(), "c.addi16sp", get_reg(rd).c_str(), get_reg(rd).c_str(), imm_);
-                return true;
-            }
+        if (xlen == 64 && funct3 == 0b100 && ((command >> 10) & 0b111) == 0b111) {
+            constexpr uint8_t ops[4] = {MN_C_SUBW, MN_C_ADDW, MN_UNKNOWN, MN_UNKNOWN};
+            return ops[(command >> 5) & 0b11];
         }
-        if (get_funct3(command) == 0b100) {
-            uint8_t rd_ = get_rd_(command);
-            if (((command >> 10) & 0b11) == 0b10) {
-                int8_t imm = (((command >> 12) & 0b1) << 5) + ((command >> 2) & 0b11111);
-                if ((imm & (1 << 5)) != 0) {
-                    imm = (imm | 0xc0);
-                }
-                if (imm != 0) {
-                    fprintf(output_file, "%08x %10s: %s %s, %d\n", cur_address, mark.c_str(), "c.andi", get_reg_(rd_).c_str(), imm);
-                    return true;
-                }
-            }
-            if (((command >> 10) & 0b111) == 0b000) {
-                uint8_t imm = ((command >> 2) & 0b11111);
-                if (imm != 0) {
-                    fprintf(output_file, "%08x %10s: %s %s, %d\n", cur_address, mark.c_str(), "c.srli", get_reg_(rd_).c_str(), imm);
-                    return true;
-                }
-            }
-            if (((command >> 10) & 0b111) == 0b001) {
-                uint8_t imm = ((command >> 2) & 0b11111);
-                if (imm != 0) {
-                    fprintf(output_file, "%08x %10s: %s %s, %d\n", cur_address, mark.c_str(), "c.srai", get_reg_(rd_).c_str(), imm);
-                    return true;
-                }
-            }
+        if (command == 0x0001) return MN_C_NOP;
+        if (funct3 == 0b000 && rd != 0 && get_ci_imm(command) != 0) return MN_C_ADDI;
+        if (funct3 == 0b010 && rd != 0) return MN_C_LI;
+        if (funct3 == 0b011 && rd != 0 && rd != 2 && get_lui_imm(command) != 0) return MN_C_LUI;
+        if (funct3 == 0b011 && rd == 2 && get_addi16sp_imm(command) != 0) return MN_C_ADDI16SP;
+        if (funct3 == 0b100 && xlen == 64) {
+            if (((command >> 10) & 0b11) == 0b10 && get_ci_imm(command) != 0) return MN_C_ANDI;
+            if (((command >> 10) & 0b11) == 0b00 && get_c_shamt64(command) != 0) return MN_C_SRLI;
+            if (((command >> 10) & 0b11) == 0b01 && get_c_shamt64(command) != 0) return MN_C_SRAI;
+        } else if (funct3 == 0b100) {
+            if (((command >> 10) & 0b11) == 0b10 && get_ci_imm(command) != 0) return MN_C_ANDI;
+            if (((command >> 10) & 0b111) == 0b000 && rs2 != 0) return MN_C_SRLI;
+            if (((command >> 10) & 0b111) == 0b001 && rs2 != 0) return MN_C_SRAI;
         }
+        if (xlen == 64 && funct3 == 0b001) return (rd != 0 ? MN_C_ADDIW : MN_UNKNOWN);
+        if (funct3 == 0b001) return MN_C_JAL;
+        if (funct3 == 0b101) return MN_C_J;
+        if (funct3 == 0b110) return MN_C_BEQZ;
+        if (funct3 == 0b111) return MN_C_BNEZ;
+        return MN_UNKNOWN;
     }
-    if (get_opcode(command) == 0b10) {
-        if (get_funct3(command) == 0b000) {
-            uint8_t rd = get_rd(command);
-            uint8_t shamt = ((command >> 2) & 0b11111);
-            if (rd != 0 && shamt != 0) {
-                fprintf(output_file, "%08x %10s: %s %s, %d\n", cur_address, mark.c_str(), "c.slli", get_reg(rd).c_str(), shamt);
-                return true;
-            }
-        }
-        if (get_funct3(command) == 0b010) {
-            uint8_t rd = get_rd(command), offset = (((command >> 2) & 0b11) << 6) + (((command >> 12) & 0b1) << 5) + (((command >> 4) & 0b111) << 2);
-            if (rd != 0) {
-                fprintf(output_file, "%08x %10s: %s %s, %d(%s)\n", cur_address, mark.c_str(), "c.lwsp", get_reg(rd).c_str(), offset, "sp");
-                return true;
-            }
-        }
+    if (opcode == 0b10) {
+        if (xlen == 64 && funct3 == 0b000) return (rd != 0 && get_c_shamt64(command) != 0 ? MN_C_SLLI : MN_UNKNOWN);
+        if (funct3 == 0b000 && rd != 0 && rs2 != 0) return MN_C_SLLI;
+        if (funct3 == 0b010 && rd != 0) return MN_C_LWSP;
+        if (xlen == 64 && funct3 == 0b011 && rd != 0) return MN_C_LDSP;
+        if (xlen == 64 && funct3 == 0b111) return MN_C_SDSP;
+        if (command == 0x9002) return MN_C_EBREAK;
+        if (funct3 == 0b100 && rd != 0 && rs2 == 0) return ((command & (1 << 12)) == 0 ? MN_C_JR : MN_C_JALR);
+        if (funct3 == 0b100 && rd != 0) return ((command & (1 << 12)) == 0 ? MN_C_MV : MN_C_ADD);
+        if (funct3 == 0b110) return MN_C_SWSP;
+        if (funct3 == 0b001) return MN_C_FLDSP;
+        if (funct3 == 0b101) return MN_C_FSDSP;
+        if (xlen == 32 && funct3 == 0b011) return MN_C_FLWSP;
+        if (xlen == 32 && funct3 == 0b111) return MN_C_FSWSP;
     }
-    return false;
+    return MN_UNKNOWN;
 }
 
-bool type_cj(uint16_t command, uint32_t cur_address, const std::string &mark, const std::string &mark_offset, FILE *output_file) {
-    if (get_opcode(command) == 0b01) {
-        std::string op;
-        int16_t offset = (((command >> 12) & 0b1) << 11) + (((command >> 8) & 0b1) << 10) + (((command >> 9) & 0b11) << 8) + (((command >> 6) & 0b1) << 7) + (((command >> 7) & 0b1) << 6) + (((command >> 2) & 0b1) << 5) + (((command >> 11) & 0b1) << 4) + (((command >> 3) & 0b111) << 1);
-        if ((offset & (1 << 11)) != 0) offset = (offset | 0xf000);
-        if (get_funct3(command) == 0b001) op = "c.jal";
-        if (get_funct3(command) == 0b101) op = "c.j";
-        if (!op.empty()) {
-            fprintf(output_file, "%08x %10s: %s %s\n", cur_address, mark.c_str(), op.c_str(), mark_offset.c_str());
-            return true;
-        }
+template<unsigned xlen>
+constexpr std::array<uint8_t, 1 << 16> make_rvc_table() {
+    std::array<uint8_t, 1 << 16> table{};
+    for (uint32_t command = 0; command < (1 << 16); command++) {
+        table[command] = classify_rvc<xlen>(command);
     }
-    return false;
+    return table;
 }
 
-bool type_cb(uint16_t command, uint32_t cur_address, const std::string &mark, const std::string &mark_offset, FILE *output_file) {
-    if (get_opcode(command) == 0b01) {
-        std::string op;
-        uint8_t rs1_ = get_rs1_(command);
-        int16_t offset = (((command >> 12) & 0b1) << 8) + (((command >> 5) & 0b11) << 6) + (((command >> 2) & 0b1) << 5) + (((command >> 10) & 0b11) << 3) + (((command >> 3) & 0b11) << 1);
-        if ((offset & (1 << 8)) != 0) {
-            offset = (offset | 0xff00);
-        }
-        if (get_funct3(command) == 0b110) op = "c.beqz";
-        if (get_funct3(command) == 0b111) op = "c.bnez";
-        if (!op.empty()) {
-            fprintf(output_file, "%08x %10s: %s %s, %s\n", cur_address, mark.c_str(), op.c_str(), get_reg_(rs1_).c_str(), mark_offset.c_str());
-            return true;
-        }
+// Mnemonic of every 16-bit parcel, for RV32 and for RV64 code.
+constexpr std::array<uint8_t, 1 << 16> rvc_table = make_rvc_table<32>();
+constexpr std::array<uint8_t, 1 << 16> rvc64_table = make_rvc_table<64>();
+
+inline int16_t get_cj_offset(uint16_t command) {
+    int16_t offset = (((command >> 12) & 0b1) << 11) + (((command >> 8) & 0b1) << 10) + (((command >> 9) & 0b11) << 8) + (((command >> 6) & 0b1) << 7) + (((command >> 7) & 0b1) << 6) + (((command >> 2) & 0b1) << 5) + (((command >> 11) & 0b1) << 4) + (((command >> 3) & 0b111) << 1);
+    if ((offset & (1 << 11)) != 0) offset = (offset | 0xf000);
+    return offset;
+}
+
+inline int16_t get_cb_offset(uint16_t command) {
+    int16_t offset = (((command >> 12) & 0b1) << 8) + (((command >> 5) & 0b11) << 6) + (((command >> 2) & 0b1) << 5) + (((command >> 10) & 0b11) << 3) + (((command >> 3) & 0b11) << 1);
+    if ((offset & (1 << 8)) != 0) {
+        offset = (offset | 0xff00);
     }
-    return false;
+    return offset;
+}
+
+// Compressed registers rd', rs1', rs2' are x8-x15.
+inline uint8_t full_reg(uint8_t reg_) {
+    return reg_ + 8;
+}
+
+template<typename Insn>
+inline void type_ciw(uint16_t command, Insn &insn) {
+    insn.operands = OPERANDS_RD_RS1_IMM;
+    insn.rd = full_reg(get_rd_(command));
+    insn.rs1 = 2;
+    insn.imm = get_addi4spn_imm(command);
 }
 
-bool type_cr(uint16_t command, uint32_t cur_address, const std::string &mark, FILE *output_file) {
-    if (command == 0x9002) {
-        fprintf(output_file, "%08x %10s: %s\n", cur_address, mark.c_str(), "c.ebreak");
-        return true;
+template<typename Insn>
+inline void type_cl(uint16_t command, Insn &insn) {
+    bool doubleword = (insn.mnemonic == MN_C_LD || insn.mnemonic == MN_C_SD || insn.mnemonic == MN_C_FLD || insn.mnemonic == MN_C_FSD);
+    uint8_t offset = (doubleword ? (((command >> 5) & 0b11) << 6) + (((command >> 10) & 0b111) << 3) : (((command >> 5) & 0b1) << 6) + (((command >> 10) & 0b111) << 3) + (((command >> 6) & 0b1) << 2));
+    insn.imm = offset;
+    insn.rs1 = full_reg(get_rs1_(command));
+    bool fp = (insn.mnemonic == MN_C_FLW || insn.mnemonic == MN_C_FSW || insn.mnemonic == MN_C_FLD || insn.mnemonic == MN_C_FSD);
+    if (insn.mnemonic == MN_C_LW || insn.mnemonic == MN_C_LD || insn.mnemonic == MN_C_FLW || insn.mnemonic == MN_C_FLD) {
+        insn.operands = (fp ? OPERANDS_FRD_IMM_RS1 : OPERANDS_RD_IMM_RS1);
+        insn.rd = full_reg(get_rd_(command));
+    } else {
+        insn.operands = (fp ? OPERANDS_FRS2_IMM_RS1 : OPERANDS_RS2_IMM_RS1);
+        insn.rs2 = full_reg(get_rs2_(command));
     }
-    if (get_opcode(command) == 0b10) {
-        if (get_funct3(command) == 0b100) {
-            std::string op;
-            uint8_t rs1 = get_rs1(command), rs2 = get_rs2(command), rd;
-            if (rs1 != 0 && rs2 == 0) {
-                if ((command & (1 << 12)) == 0) op = "c.jr"; else op = "c.jalr";
-                fprintf(output_file, "%08x %10s: %s %s\n", cur_address, mark.c_str(), op.c_str(), get_reg(rs1).c_str());
-                return true;
-            }
-            if (rs1 != 0) {
-                rd = rs1;
-                if ((command & (1 << 12)) == 0) op = "c.mv"; else op = "c.add";
-                fprintf(output_file, "%08x %10s: %s %s, %s\n", cur_address, mark.c_str(), op.c_str(), get_reg(rd).c_str(), get_reg(rs2).c_str());
-                return true;
-            }
+}
+
+template<typename Insn>
+inline void type_cs(uint16_t command, Insn &insn) {
+    insn.operands = OPERANDS_RD_RS2;
+    insn.rd = full_reg(get_rs1_(command));
+    insn.rs1 = insn.rd;
+    insn.rs2 = full_reg(get_rs2_(command));
+}
+
+template<typename Insn>
+inline void type_ci(uint16_t command, Insn &insn) {
+    uint8_t rd = get_rd(command);
+    switch (insn.mnemonic) {
+        case MN_C_NOP:
+            break;
+        case MN_C_ADDI:
+        case MN_C_ADDIW:
+            insn.operands = OPERANDS_RD_RS1_IMM;
+            insn.rd = insn.rs1 = rd;
+            insn.imm = get_ci_imm(command);
+            break;
+        case MN_C_LI:
+            insn.operands = OPERANDS_RD_IMM;
+            insn.rd = rd;
+            insn.imm = get_ci_imm(command);
+            break;
+        case MN_C_LUI:
+            insn.operands = OPERANDS_RD_IMM;
+            insn.rd = rd;
+            insn.imm = get_lui_imm(command);
+            break;
+        case MN_C_ADDI16SP:
+            insn.operands = OPERANDS_RD_RS1_IMM;
+            insn.rd = insn.rs1 = rd;
+            insn.imm = get_addi16sp_imm(command);
+            break;
+        case MN_C_ANDI:
+            insn.operands = OPERANDS_RD_IMM;
+            insn.rd = insn.rs1 = full_reg(get_rd_(command));
+            insn.imm = get_ci_imm(command);
+            break;
+        case MN_C_SRLI:
+        case MN_C_SRAI:
+            insn.operands = OPERANDS_RD_IMM;
+            insn.rd = insn.rs1 = full_reg(get_rd_(command));
+            insn.imm = (sizeof insn.address == 8 ? get_c_shamt64(command) : (command >> 2) & 0b11111);
+            break;
+        case MN_C_SLLI:
+            insn.operands = OPERANDS_RD_IMM;
+            insn.rd = insn.rs1 = rd;
+            insn.imm = (sizeof insn.address == 8 ? get_c_shamt64(command) : (command >> 2) & 0b11111);
+            break;
+        case MN_C_LDSP:
+        case MN_C_FLDSP: {
+            uint16_t offset = (((command >> 2) & 0b111) << 6) + (((command >> 12) & 0b1) << 5) + (((command >> 5) & 0b11) << 3);
+            insn.operands = (insn.mnemonic == MN_C_FLDSP ? OPERANDS_FRD_IMM_RS1 : OPERANDS_RD_IMM_RS1);
+            insn.rd = rd;
+            insn.rs1 = 2;
+            insn.imm = offset;
+            break;
+        }
+        default: {
+            uint8_t offset = (((command >> 2) & 0b11) << 6) + (((command >> 12) & 0b1) << 5) + (((command >> 4) & 0b111) << 2);
+            insn.operands = (insn.mnemonic == MN_C_FLWSP ? OPERANDS_FRD_IMM_RS1 : OPERANDS_RD_IMM_RS1);
+            insn.rd = rd;
+            insn.rs1 = 2;
+            insn.imm = offset;
+            break;
         }
     }
-    return false;
 }
 
-bool type_css(uint16_t command, uint32_t cur_address, const std::string &mark, FILE *output_file) {
-    if (get_opcode(command) == 0b10) {
-        if (get_funct3(command) == 0b110) {
-            int8_t rs2 = get_rs2(command), offset = (((command >> 7) & 0b11) << 6) + (((command >> 9) & 0b1111) << 2);
-            fprintf(output_file, "%08x %10s: %s %s, %d(%s)\n", cur_address, mark.c_str(), "c.swsp", get_reg(rs2).c_str(), offset, "sp");
-            return true;
-        }
+template<typename Insn>
+inline void type_cj(uint16_t command, Insn &insn) {
+    int16_t offset = get_cj_offset(command);
+    insn.operands = OPERANDS_LABEL;
+    insn.rd = (insn.mnemonic == MN_C_JAL ? 1 : 0);
+    insn.imm = offset;
+    insn.target = insn.address + offset;
+    insn.has_target = 1;
+}
+
+template<typename Insn>
+inline void type_cb(uint16_t command, Insn &insn) {
+    int16_t offset = get_cb_offset(command);
+    insn.operands = OPERANDS_RS1_LABEL;
+    insn.rs1 = full_reg(get_rs1_(command));
+    insn.imm = offset;
+    insn.target = insn.address + offset;
+    insn.has_target = 1;
+}
+
+template<typename Insn>
+inline void type_cr(uint16_t command, Insn &insn) {
+    if (insn.mnemonic == MN_C_EBREAK) return;
+    if (insn.mnemonic == MN_C_JR || insn.mnemonic == MN_C_JALR) {
+        insn.operands = OPERANDS_RS1;
+        insn.rs1 = get_rs1(command);
+        insn.rd = (insn.mnemonic == MN_C_JALR ? 1 : 0);
+    } else {
+        insn.operands = OPERANDS_RD_RS2;
+        insn.rd = get_rs1(command);
+        insn.rs1 = (insn.mnemonic == MN_C_ADD ? insn.rd : 0);
+        insn.rs2 = get_rs2(command);
     }
-    return false;
 }
 
-void rvc(uint16_t command, uint32_t cur_address, const std::string &mark, const std::string &mark_offset, FILE *output_file) {
-    if (type_ciw(command, cur_address, mark, output_file)) return;
-    if (type_cl(command, cur_address, mark, output_file)) return;
-    if (type_cs(command, cur_address, mark, output_file)) return;
-    if (type_ci(command, cur_address, mark, output_file)) return;
-    if (type_cj(command, cur_address, mark, mark_offset, output_file)) return;
-    if (type_cb(command, cur_address, mark, mark_offset, output_file)) return;
-    if (type_cr(command, cur_address, mark, output_file)) return;
-    if (type_css(command, cur_address, mark, output_file)) return;
-    fprintf(output_file, "%08x %10s: %s\n", cur_address, mark.c_str(), "unknown_command");
+template<typename Insn>
+inline void type_css(uint16_t command, Insn &insn) {
+    bool fp = (insn.mnemonic == MN_C_FSWSP || insn.mnemonic == MN_C_FSDSP);
+    insn.operands = (fp ? OPERANDS_FRS2_IMM_RS1 : OPERANDS_RS2_IMM_RS1);
+    insn.rs1 = 2;
+    insn.rs2 = get_rs2(command);
+    if (insn.mnemonic == MN_C_SDSP || insn.mnemonic == MN_C_FSDSP) {
+        insn.imm = (((command >> 7) & 0b111) << 6) + (((command >> 10) & 0b111) << 3);
+        return;
+    }
+    if (fp) {
+        insn.imm = (((command >> 7) & 0b11) << 6) + (((command >> 9) & 0b1111) << 2);
+        return;
+    }
+    // int8_t keeps offsets of 128 and above printed the way they always have been.
+    int8_t offset = (((command >> 7) & 0b11) << 6) + (((command >> 9) & 0b1111) << 2);
+    insn.imm = offset;
+}
+
+// Decodes a 16-bit instruction of RV32C or RV64C code, by ELF::xlen.
+template<typename ELF>
+inline Basic_Insn<typename ELF::Address> decode_rvc(uint16_t command, typename ELF::Address cur_address) {
+    Basic_Insn<typename ELF::Address> insn{};
+    insn.address = cur_address;
+    insn.length = 2;
+    insn.mnemonic = (ELF::xlen == 64 ? rvc64_table : rvc_table)[command];
+    switch (insn.mnemonic) {
+        case MN_C_ADDI4SPN: type_ciw(command, insn); break;
+        case MN_C_LW: case MN_C_SW: case MN_C_LD: case MN_C_SD: case MN_C_FLW: case MN_C_FSW: case MN_C_FLD: case MN_C_FSD: type_cl(command, insn); break;
+        case MN_C_SUB: case MN_C_XOR: case MN_C_OR: case MN_C_AND: case MN_C_SUBW: case MN_C_ADDW: type_cs(command, insn); break;
+        case MN_C_NOP: case MN_C_ADDI: case MN_C_LI: case MN_C_LUI: case MN_C_ADDI16SP: case MN_C_ANDI: case MN_C_SRLI: case MN_C_SRAI: case MN_C_SLLI: case MN_C_LWSP:
+        case MN_C_ADDIW: case MN_C_LDSP: case MN_C_FLWSP: case MN_C_FLDSP:
+            type_ci(command, insn);
+            break;
+        case MN_C_JAL: case MN_C_J: type_cj(command, insn); break;
+        case MN_C_BEQZ: case MN_C_BNEZ: type_cb(command, insn); break;
+        case MN_C_EBREAK: case MN_C_JR: case MN_C_JALR: case MN_C_MV: case MN_C_ADD: type_cr(command, insn); break;
+        case MN_C_SWSP: case MN_C_SDSP: case MN_C_FSWSP: case MN_C_FSDSP: type_css(command, insn); break;
+        default: break;
+    }
+    return insn;
 }
 
 #endif //LAB3_RVC_HPP
@@ -0,0 +1,255 @@
+#ifndef LAB3_RVEXT_HPP
+#define LAB3_RVEXT_HPP
+
+#include "rv32im.hpp"
+
+// Formats of the opcodes that RV32IM/RV64IM leave to the other standard extensions. Every extension registers its
+// opcodes in the one format table below, so whatever extensions are known, an instruction costs a single lookup and
+// switch. Whether the file's extensions include it is checked once the mnemonic is known, see extension_of.
+enum Ext_Format : uint8_t {
+    FORMAT_SYSTEM = FORMAT_R_32 + 1,   // ecall, ebreak, mret, sret, wfi; Zicsr
+    FORMAT_MISC_MEM,                   // fence, fence.tso; Zifencei
+    FORMAT_AMO,                        // A
+    FORMAT_LOAD_FP,                    // F and D
+    FORMAT_STORE_FP,
+    FORMAT_OP_FP,
+    FORMAT_FMA
+};
+
+template<unsigned xlen>
+constexpr std::array<uint8_t, 128> make_formats() {
+    std::array<uint8_t, 128> formats = (xlen == 64 ? make_rv64_formats() : make_rv32_formats());
+    formats[0b1110011] = FORMAT_SYSTEM;
+    formats[0b0001111] = FORMAT_MISC_MEM;
+    formats[0b0101111] = FORMAT_AMO;
+    formats[0b0000111] = FORMAT_LOAD_FP;
+    formats[0b0100111] = FORMAT_STORE_FP;
+    formats[0b1010011] = FORMAT_OP_FP;
+    formats[0b1000011] = FORMAT_FMA;
+    formats[0b1000111] = FORMAT_FMA;
+    formats[0b1001011] = FORMAT_FMA;
+    formats[0b1001111] = FORMAT_FMA;
+    return formats;
+}
+
+// Format of a 32-bit instruction by its 7-bit opcode, for RV32 and for RV64 code.
+constexpr std::array<uint8_t, 128> formats32 = make_formats<32>();
+constexpr std::array<uint8_t, 128> formats64 = make_formats<64>();
+
+constexpr uint8_t csr_ops[8] = {MN_UNKNOWN, MN_CSRRW, MN_CSRRS, MN_CSRRC, MN_UNKNOWN, MN_CSRRWI, MN_CSRRSI, MN_CSRRCI};
+// By funct5; the .d forms follow the .w ones in the same order.
+constexpr uint8_t amo_ops[32] = {
+        MN_AMOADD_W, MN_AMOSWAP_W, MN_LR_W, MN_SC_W, MN_AMOXOR_W, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN,
+        MN_AMOOR_W, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_AMOAND_W, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN,
+        MN_AMOMIN_W, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_AMOMAX_W, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN,
+        MN_AMOMINU_W, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_AMOMAXU_W, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN
+};
+const uint8_t amo_doubleword = MN_LR_D - MN_LR_W;
+
+// The single-precision forms by funct3 or rs2; the D forms are the same distance further in Mnemonic, up to fmv.d.x.
+constexpr uint8_t fp_sign_ops[8] = {MN_FSGNJ_S, MN_FSGNJN_S, MN_FSGNJX_S, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN};
+constexpr uint8_t fp_min_max_ops[8] = {MN_FMIN_S, MN_FMAX_S, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN};
+constexpr uint8_t fp_compare_ops[8] = {MN_FLE_S, MN_FLT_S, MN_FEQ_S, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN, MN_UNKNOWN};
+constexpr uint8_t fp_to_int_ops[4] = {MN_FCVT_W_S, MN_FCVT_WU_S, MN_FCVT_L_S, MN_FCVT_LU_S};
+constexpr uint8_t fp_from_int_ops[4] = {MN_FCVT_S_W, MN_FCVT_S_WU, MN_FCVT_S_L, MN_FCVT_S_LU};
+const uint8_t fp_double = MN_FLD - MN_FLW;
+
+// ecall, ebreak, mret, sret and wfi, and the Zicsr instructions.
+template<typename Insn>
+inline void type_system(uint32_t command, Insn &insn) {
+    uint8_t func3 = get_func3(command);
+    if (func3 == 0b000) {
+        if (get_rd(command) != 0 || get_rs1(command) != 0) return;
+        switch (command >> 20) {
+            case 0x000: insn.mnemonic = MN_ECALL; break;
+            case 0x001: insn.mnemonic = MN_EBREAK; break;
+            case 0x102: insn.mnemonic = MN_SRET; break;
+            case 0x302: insn.mnemonic = MN_MRET; break;
+            case 0x105: insn.mnemonic = MN_WFI; break;
+            default: break;
+        }
+        return;
+    }
+    insn.mnemonic = csr_ops[func3];
+    if (insn.mnemonic == MN_UNKNOWN) return;
+    insn.operands = (func3 >= 0b101 ? OPERANDS_RD_CSR_UIMM : OPERANDS_RD_CSR_RS1);
+    insn.rd = get_rd(command);
+    insn.rs1 = get_rs1(command);
+    insn.imm = command >> 20;
+}
+
+// fence and fence.tso, and the Zifencei fence.i. Their rd and rs1 (and the immediate of fence.i) are reserved and
+// must be zero.
+template<typename Insn>
+inline void type_misc_mem(uint32_t command, Insn &insn) {
+    uint8_t func3 = get_func3(command);
+    if (get_rd(command) != 0 || get_rs1(command) != 0) return;
+    if (func3 == 0b001) {
+        if ((command >> 20) == 0) insn.mnemonic = MN_FENCE_I;
+        return;
+    }
+    uint8_t fm = command >> 28, pred = (command >> 24) & 0b1111, succ = (command >> 20) & 0b1111;
+    if (func3 != 0b000) return;
+    if (fm == 0b1000 && pred == 0b0011 && succ == 0b0011) {
+        insn.mnemonic = MN_FENCE_TSO;
+        return;
+    }
+    if (fm != 0) return;
+    insn.mnemonic = MN_FENCE;
+    insn.operands = OPERANDS_FENCE;
+    insn.imm = (pred << 4) | succ;
+}
+
+// lr, sc and the AMOs, .w and on RV64 .d; the aq and rl bits go to imm.
+template<typename ELF>
+inline void type_amo(uint32_t command, Basic_Insn<typename ELF::Address> &insn) {
+    uint8_t func3 = get_func3(command), mnemonic = amo_ops[get_func5(command)];
+    if ((func3 != 0b010 && (func3 != 0b011 || ELF::xlen != 64)) || mnemonic == MN_UNKNOWN) return;
+    if (mnemonic == MN_LR_W && get_rs2(command) != 0) return;
+    insn.mnemonic = mnemonic + (func3 == 0b011 ? amo_doubleword : 0);
+    insn.operands = (mnemonic == MN_LR_W ? OPERANDS_RD_ADDR : OPERANDS_RD_RS2_ADDR);
+    insn.rd = get_rd(command);
+    insn.rs1 = get_rs1(command);
+    insn.rs2 = (mnemonic == MN_LR_W ? 0 : get_rs2(command));
+    insn.imm = get_func2(command);
+}
+
+template<typename Insn>
+inline void type_load_fp(uint32_t command, Insn &insn) {
+    uint8_t func3 = get_func3(command);
+    if (func3 != 0b010 && func3 != 0b011) return;
+    insn.mnemonic = (func3 == 0b010 ? MN_FLW : MN_FLD);
+    insn.operands = OPERANDS_FRD_IMM_RS1;
+    insn.rd = get_rd(command);
+    insn.rs1 = get_rs1(command);
+    insn.imm = get_imm_i(command);
+}
+
+template<typename Insn>
+inline void type_store_fp(uint32_t command, Insn &insn) {
+    uint8_t func3 = get_func3(command);
+    if (func3 != 0b010 && func3 != 0b011) return;
+    insn.mnemonic = (func3 == 0b010 ? MN_FSW : MN_FSD);
+    insn.operands = OPERANDS_FRS2_IMM_RS1;
+    insn.rs1 = get_rs1(command);
+    insn.rs2 = get_rs2(command);
+    insn.imm = get_imm_s(command);
+}
+
+// The OP-FP instructions of F and D: funct5 picks the operation, the low bits of funct7 the format (S or D) and
+// funct3 either the rounding mode or the operation within a group.
+template<typename ELF>
+inline void type_op_fp(uint32_t command, Basic_Insn<typename ELF::Address> &insn) {
+    uint8_t fmt = get_func2(command), func3 = get_func3(command), rs2 = get_rs2(command), func5 = get_func5(command);
+    if (fmt > 1) return;
+    uint8_t mnemonic = MN_UNKNOWN, operands = OPERANDS_NONE;
+    bool rounding = false;   // funct3 is a rounding mode
+    switch (func5) {
+        case 0b00000: case 0b00001: case 0b00010: case 0b00011:
+            mnemonic = MN_FADD_S + func5;
+            operands = OPERANDS_FRD_FRS1_FRS2_RM;
+            rounding = true;
+            break;
+        case 0b01011:
+            if (rs2 == 0) mnemonic = MN_FSQRT_S;
+            operands = OPERANDS_FRD_FRS1_RM;
+            rounding = true;
+            break;
+        case 0b00100:
+            mnemonic = fp_sign_ops[func3];
+            operands = OPERANDS_FRD_FRS1_FRS2;
+            break;
+        case 0b00101:
+            mnemonic = fp_min_max_ops[func3];
+            operands = OPERANDS_FRD_FRS1_FRS2;
+            break;
+        case 0b10100:
+            mnemonic = fp_compare_ops[func3];
+            operands = OPERANDS_RD_FRS1_FRS2;
+            break;
+        case 0b11000:
+            if (rs2 < 2 || (rs2 < 4 && ELF::xlen == 64)) mnemonic = fp_to_int_ops[rs2];
+            operands = OPERANDS_RD_FRS1_RM;
+            rounding = true;
+            break;
+        case 0b11010:
+            if (rs2 < 2 || (rs2 < 4 && ELF::xlen == 64)) mnemonic = fp_from_int_ops[rs2];
+            // Every int32 is exact in a double, so fcvt.d.w[u] has no rounding mode: its rm field must be zero.
+            if (fmt == 1 && rs2 < 2 && func3 != 0) mnemonic = MN_UNKNOWN;
+            operands = (fmt == 1 && rs2 < 2 ? OPERANDS_FRD_RS1 : OPERANDS_FRD_RS1_RM);
+            rounding = (operands == OPERANDS_FRD_RS1_RM);
+            break;
+        case 0b11100:
+            if (rs2 == 0 && func3 == 0b001) mnemonic = MN_FCLASS_S;
+            if (rs2 == 0 && func3 == 0b000 && (fmt == 0 || ELF::xlen == 64)) mnemonic = MN_FMV_X_W;
+            operands = OPERANDS_RD_FRS1;
+            break;
+        case 0b11110:
+            if (rs2 == 0 && func3 == 0b000 && (fmt == 0 || ELF::xlen == 64)) mnemonic = MN_FMV_W_X;
+            operands = OPERANDS_FRD_RS1;
+            break;
+        case 0b01000:
+            // fcvt.s.d and fcvt.d.s, which are outside the parallel S and D ranges of Mnemonic; fcvt.d.s is exact.
+            if (rs2 != (fmt == 0 ? 1 : 0) || func3 == 0b101 || func3 == 0b110 || (fmt == 1 && func3 != 0)) return;
+            insn.mnemonic = (fmt == 0 ? MN_FCVT_S_D : MN_FCVT_D_S);
+            insn.operands = (fmt == 0 ? OPERANDS_FRD_FRS1_RM : OPERANDS_FRD_FRS1);
+            insn.rd = get_rd(command);
+            insn.rs1 = get_rs1(command);
+            insn.imm = (fmt == 0 ? func3 : 0);
+            return;
+        default:
+            return;
+    }
+    if (mnemonic == MN_UNKNOWN || (rounding && (func3 == 0b101 || func3 == 0b110))) return;
+    insn.mnemonic = mnemonic + fmt * fp_double;
+    insn.operands = operands;
+    insn.rd = get_rd(command);
+    insn.rs1 = get_rs1(command);
+    insn.rs2 = rs2;
+    insn.imm = (rounding ? func3 : 0);
+}
+
+// fmadd, fmsub, fnmsub and fnmadd by the opcode; rs3 and the rounding mode go to imm.
+template<typename Insn>
+inline void type_fma(uint32_t command, Insn &insn) {
+    uint8_t fmt = get_func2(command), rm = get_func3(command);
+    if (fmt > 1 || rm == 0b101 || rm == 0b110) return;
+    insn.mnemonic = MN_FMADD_S + ((get_opcode(command) >> 2) & 0b11) + fmt * fp_double;
+    insn.operands = OPERANDS_FRD_FRS1_FRS2_FRS3_RM;
+    insn.rd = get_rd(command);
+    insn.rs1 = get_rs1(command);
+    insn.rs2 = get_rs2(command);
+    insn.imm = (get_func5(command) << 3) | rm;
+}
+
+// Decodes a 32-bit instruction of RV32 or RV64 code, by ELF::xlen, of any extension with a decoder above or in
+// rv32im.hpp. Extensions the file does not have are filtered out by decode_insn().
+template<typename ELF>
+inline Basic_Insn<typename ELF::Address> decode_rvim(uint32_t command, typename ELF::Address cur_address) {
+    Basic_Insn<typename ELF::Address> insn{};
+    insn.address = cur_address;
+    insn.length = 4;
+    switch ((ELF::xlen == 64 ? formats64 : formats32)[get_opcode(command)]) {
+        case FORMAT_U: type_u(command, insn); break;
+        case FORMAT_UJ: type_uj(command, insn); break;
+        case FORMAT_I_LOAD: type_i_load<ELF>(command, insn); break;
+        case FORMAT_I_JALR: type_i_jalr(command, insn); break;
+        case FORMAT_I: type_i<ELF>(command, insn); break;
+        case FORMAT_SB: type_sb(command, insn); break;
+        case FORMAT_S: type_s<ELF>(command, insn); break;
+        case FORMAT_R: type_r<ELF>(command, insn); break;
+        case FORMAT_I_32: type_i_32<ELF>(command, insn); break;
+        case FORMAT_R_32: type_r_32<ELF>(command, insn); break;
+        case FORMAT_SYSTEM: type_system(command, insn); break;
+        case FORMAT_MISC_MEM: type_misc_mem(command, insn); break;
+        case FORMAT_AMO: type_amo<ELF>(command, insn); break;
+        case FORMAT_LOAD_FP: type_load_fp(command, insn); break;
+        case FORMAT_STORE_FP: type_store_fp(command, insn); break;
+        case FORMAT_OP_FP: type_op_fp<ELF>(command, insn); break;
+        case FORMAT_FMA: type_fma(command, insn); break;
+        default: break;
+    }
+    return insn;
+}
+
+#endif //LAB3_RVEXT_HPP
@@ -0,0 +1,301 @@
+#ifndef LAB3_SERVER_HPP
+#define LAB3_SERVER_HPP
+
+#include "disasm.hpp"
+#include "index_file.hpp"
+#include "query.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <future>
+#include <limits>
+#include <list>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Parsed ELF files shared by all connections of the server: at most `capacity` of them, the least recently used one
+// is dropped first. A file is keyed by its path and checked with stat() on every request, so a file that was rebuilt
+// is parsed again. Parsing happens outside the lock; a file requested while it is being parsed waits for that parse.
+// Requests still using a dropped Disassembler keep it alive until they finish. Files of both ELF classes are served.
+class Image_Cache {
+private:
+    struct Entry {
+        std::string path;
+        uint64_t mtime_ns, inode, device;
+        uint64_t generation;
+        std::shared_future<std::shared_ptr<const Any_Disassembler>> image;
+    };
+
+    std::list<Entry> entries;   // most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> by_path;
+    std::mutex mutex;
+    size_t capacity;
+    bool use_index;
+    uint64_t generations = 0;
+
+    void drop(std::unordered_map<std::string, std::list<Entry>::iterator>::iterator found) {
+        entries.erase(found->second);
+        by_path.erase(found);
+    }
+
+public:
+    Image_Cache(size_t capacity, bool use_index) : capacity(std::max<size_t>(1, capacity)), use_index(use_index) {}
+
+    std::shared_ptr<const Any_Disassembler> get(const std::string &path) {
+        uint64_t mtime_ns, inode, device;
+        if (!file_identity(path.c_str(), mtime_ns, inode, device)) throw FileNotFoundException("Unable to open input file!");
+        std::unique_lock<std::mutex> lock(mutex);
+        auto found = by_path.find(path);
+        if (found != by_path.end()) {
+            const Entry &entry = *found->second;
+            if (entry.mtime_ns == mtime_ns && entry.inode == inode && entry.device == device) {
+                entries.splice(entries.begin(), entries, found->second);
+                std::shared_future<std::shared_ptr<const Any_Disassembler>> image = entry.image;
+                lock.unlock();
+                return image.get();
+            }
+            drop(found);
+        }
+
+        std::promise<std::shared_ptr<const Any_Disassembler>> loaded;
+        uint64_t generation = ++generations;
+        entries.push_front({path, mtime_ns, inode, device, generation, loaded.get_future().share()});
+        by_path[path] = entries.begin();
+        while (entries.size() > capacity) {
+            by_path.erase(entries.back().path);
+            entries.pop_back();
+        }
+        lock.unlock();
+
+        try {
+            auto disassembler = std::make_shared<Any_Disassembler>();
+            if (use_index) disassembler->open(path.c_str(), default_index_path(path.c_str()).c_str());
+            else disassembler->open(path.c_str());
+            loaded.set_value(disassembler);
+            return disassembler;
+        } catch (...) {
+            // Not cached: the next request for the file tries again.
+            loaded.set_exception(std::current_exception());
+            lock.lock();
+            found = by_path.find(path);
+            if (found != by_path.end() && found->second->generation == generation) drop(found);
+            throw;
+        }
+    }
+};
+
+// Cuts the next space-separated word off the front of `rest`.
+inline std::string_view next_word(std::string_view &rest) {
+    size_t begin = std::min(rest.find_first_not_of(' '), rest.size());
+    size_t end = std::min(rest.find(' ', begin), rest.size());
+    std::string_view word = rest.substr(begin, end - begin);
+    rest = rest.substr(std::min(rest.find_first_not_of(' ', end), rest.size()));
+    return word;
+}
+
+// Answers one request line into `output`. The file is always the last argument and takes the rest of the line:
+//   range BEGIN END FILE      instructions starting in [BEGIN, END), as --range
+//   pc ADDRESS CONTEXT FILE   CONTEXT bytes around ADDRESS, as --pc and --context
+//   symbol NAME FILE          the instructions of symbol NAME, as --symbol
+//   lookup ADDRESS FILE       "NAME+0xOFFSET 0xBEGIN 0xEND" of the symbol containing ADDRESS
+//   info FILE                 "text 0xADDRESS SIZE" and "symbols COUNT"
+// Addresses in the replies have 8 hex digits for ELF32 files and 16 for ELF64 ones, as in the listing.
+inline void handle_request(std::string_view line, Image_Cache &cache, Output_Buffer &output) {
+    std::string_view rest = line;
+    std::string_view command = next_word(rest);
+    Text_Query query;
+    uint64_t address = 0;
+    if (command == "range") {
+        query.begin = parse_address(next_word(rest));
+        query.end = parse_address(next_word(rest));
+        query.has_range = true;
+    } else if (command == "pc") {
+        query.pc = parse_address(next_word(rest));
+        query.context = parse_address(next_word(rest));
+        query.has_pc = true;
+    } else if (command == "symbol") {
+        query.symbol = next_word(rest);
+    } else if (command == "lookup") {
+        address = parse_address(next_word(rest));
+    } else if (command != "info") {
+        throw std::invalid_argument("Unknown request!");
+    }
+    if (rest.empty()) throw std::invalid_argument("Invalid number of arguments!");
+
+    std::shared_ptr<const Any_Disassembler> image = cache.get(std::string(rest));
+    image->visit([&](const auto &disassembler) {
+        using Address = typename std::decay_t<decltype(disassembler)>::Address;
+        int width = 2 * sizeof(Address);
+        if (command == "lookup") {
+            const auto *symbol = (address <= std::numeric_limits<Address>::max() ? disassembler.symbols().containing(address) : nullptr);
+            if (symbol == nullptr) throw std::invalid_argument("No symbol at address!");
+            std::string name(disassembler.symbols().name(*symbol));
+            output.print("%s+0x%llx 0x%0*llx 0x%0*llx\n", name.c_str(), (unsigned long long)(address - symbol->begin), width, (unsigned long long)symbol->begin, width,
+                         (unsigned long long)symbol->end);
+        } else if (command == "info") {
+            output.print("text 0x%0*llx %llu\nsymbols %zu\n", width, (unsigned long long)disassembler.text_address(), (unsigned long long)disassembler.text_size(),
+                         disassembler.symbols().size());
+        } else {
+            print_query(disassembler, query, output);
+        }
+    });
+}
+
+inline bool send_all(int fd, const char *data, size_t size, int flags) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, flags | MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent <= 0) return false;
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+// Reads request lines from one client until it disconnects. Each reply is "OK <length>\n" followed by <length> bytes
+// of text, or "ERR <message>\n"; replies come in the order of the requests.
+inline void serve_connection(int fd, Image_Cache &cache) {
+    static const size_t max_line = 1 << 16;
+    std::string pending;
+    char buffer[1 << 16];
+    Output_Buffer output(nullptr);
+    for (;;) {
+        ssize_t got = recv(fd, buffer, sizeof buffer, 0);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) break;
+        pending.append(buffer, got);
+        size_t begin = 0, newline;
+        bool ok = true;
+        while (ok && (newline = pending.find('\n', begin)) != std::string::npos) {
+            std::string_view line(pending.data() + begin, newline - begin);
+            if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+            begin = newline + 1;
+            if (line.empty()) continue;
+            char header[96];
+            output.clear();
+            try {
+                handle_request(line, cache, output);
+                int length = snprintf(header, sizeof header, "OK %zu\n", output.view().size());
+                ok = send_all(fd, header, length, MSG_MORE) && send_all(fd, output.view().data(), output.view().size(), 0);
+            } catch (std::exception &e) {
+                int length = snprintf(header, sizeof header, "ERR %s\n", e.what());
+                ok = send_all(fd, header, std::min<size_t>(length, sizeof header - 1), 0);
+            }
+        }
+        pending.erase(0, begin);
+        if (!ok || pending.size() > max_line) break;
+    }
+    close(fd);
+}
+
+struct Serve_Options {
+    size_t cache_size = 16;
+    size_t max_connections = 64;   // served at once; further clients wait in the listen backlog
+    bool use_index = false;
+};
+
+// Counts the connections being served, so that no more than `capacity` threads are running at once.
+class Connection_Slots {
+private:
+    std::mutex mutex;
+    std::condition_variable released;
+    size_t used = 0, capacity;
+
+public:
+    explicit Connection_Slots(size_t capacity) : capacity(std::max<size_t>(1, capacity)) {}
+
+    void acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        released.wait(lock, [this] { return used < capacity; });
+        used++;
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            used--;
+        }
+        released.notify_one();
+    }
+};
+
+inline char served_socket_path[sizeof(sockaddr_un::sun_path)];
+
+// Removes a socket left at address by a server that is gone, which no one accepts connections on. Throws if anything
+// else is there: a file that is not a socket, or a socket some server still answers on.
+inline void remove_stale_socket(const sockaddr_un &address) {
+    struct stat status{};
+    if (lstat(address.sun_path, &status) != 0) return;
+    if (!S_ISSOCK(status.st_mode)) throw FileNotFoundException("Socket path is in use!");
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe < 0) throw FileNotFoundException("Unable to open socket!");
+    bool refused = connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof address) != 0 && errno == ECONNREFUSED;
+    close(probe);
+    if (!refused) throw FileNotFoundException("Socket path is in use!");
+    unlink(address.sun_path);
+}
+
+// Listens on the Unix socket at socket_path and serves every connection on its own thread, at most
+// options.max_connections of them at once, until SIGINT or SIGTERM, which remove the socket file. A socket left at
+// socket_path by a previous run is replaced; any other file there, or a socket of a running server, is left alone and
+// the server does not start.
+inline void serve(const char *socket_path, const Serve_Options &options) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (strlen(socket_path) >= sizeof address.sun_path) throw std::invalid_argument("Socket path is too long!");
+    strcpy(address.sun_path, socket_path);
+    remove_stale_socket(address);
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0) throw FileNotFoundException("Unable to open socket!");
+    if (bind(listener, reinterpret_cast<sockaddr *>(&address), sizeof address) != 0 || listen(listener, SOMAXCONN) != 0) {
+        close(listener);
+        throw FileNotFoundException("Unable to open socket!");
+    }
+    strcpy(served_socket_path, socket_path);
+    auto stop = [](int) {
+        unlink(served_socket_path);
+        _exit(0);
+    };
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    signal(SIGPIPE, SIG_IGN);
+
+    auto cache = std::make_shared<Image_Cache>(options.cache_size, options.use_index);
+    auto slots = std::make_shared<Connection_Slots>(options.max_connections);
+    for (;;) {
+        slots->acquire();
+        int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) {
+            slots->release();
+            if (errno == EINTR || errno == ECONNABORTED || errno == EPROTO) continue;
+            if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+                // Out of descriptors or memory for now: the connections being served free some when they end.
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            close(listener);
+            throw FileNotFoundException("Unable to accept a connection!");
+        }
+        try {
+            std::thread([client, cache, slots] {
+                serve_connection(client, *cache);
+                slots->release();
+            }).detach();
+        } catch (std::system_error &) {
+            // Out of threads: this client is dropped, the ones being served go on.
+            close(client);
+            slots->release();
+        }
+    }
+}
+
+#endif //LAB3_SERVER_HPP
@@ -0,0 +1,151 @@
+#ifndef LAB3_STATS_HPP
+#define LAB3_STATS_HPP
+
+#include "output.hpp"
+#include "rvc.hpp"
+#include "rvext.hpp"
+
+#include <chrono>
+
+// The instrumentation behind --stats is built with LAB3_STATS defined (the CMake option of the same name). Without
+// it every counter and timer below is dead code behind stats_enabled, Output_Buffer keeps no write counters, and
+// --stats is rejected.
+#ifdef LAB3_STATS
+const bool stats_enabled = true;
+#else
+const bool stats_enabled = false;
+#endif
+
+// Stages of disasm(), in order. The print stage leaves out the time spent writing to the file, which is `write`.
+enum Stat_Stage : uint8_t {
+    STAGE_PARSE,     // file header, section headers and .riscv.attributes, splitting into work items
+    STAGE_LABELS,    // the pass collecting jump and branch targets (decoding everything with --single-pass)
+    STAGE_SYMBOLS,   // the label index of .symtab and the targets
+    STAGE_PRINT,     // decoding and formatting the listing and .symtab
+    STAGE_WRITE,     // fwrite of the output
+    STAGE_COUNT
+};
+
+constexpr std::string_view stage_names[STAGE_COUNT] = {"parse", "labels", "symbols", "print", "write"};
+
+// Formats of instructions, named after the type_* decoders: the formats of 32-bit opcodes are the Rv32_Format and
+// Ext_Format values, those of RVC follow. FORMAT_UNKNOWN counts the opcodes that have none.
+enum Stat_Format : uint8_t {
+    STAT_CIW = FORMAT_FMA + 1,
+    STAT_CL,
+    STAT_CS,
+    STAT_CI,
+    STAT_CJ,
+    STAT_CB,
+    STAT_CR,
+    STAT_CSS,
+    STAT_FORMAT_COUNT
+};
+
+constexpr std::string_view stat_format_names[STAT_FORMAT_COUNT] = {
+        "unknown", "type_u", "type_uj", "type_i_load", "type_i_jalr", "type_i", "type_sb", "type_s", "type_r", "type_i_32",
+        "type_r_32", "type_system", "type_misc_mem", "type_amo", "type_load_fp", "type_store_fp", "type_op_fp", "type_fma",
+        "type_ciw", "type_cl", "type_cs", "type_ci", "type_cj", "type_cb", "type_cr", "type_css"
+};
+
+// The RVC format of a mnemonic, as decode_rvc() dispatches it.
+inline uint8_t rvc_stat_format(uint8_t mnemonic) {
+    switch (mnemonic) {
+        case MN_C_ADDI4SPN: return STAT_CIW;
+        case MN_C_LW: case MN_C_SW: case MN_C_LD: case MN_C_SD: case MN_C_FLW: case MN_C_FSW: case MN_C_FLD: case MN_C_FSD: return STAT_CL;
+        case MN_C_SUB: case MN_C_XOR: case MN_C_OR: case MN_C_AND: case MN_C_SUBW: case MN_C_ADDW: return STAT_CS;
+        case MN_C_NOP: case MN_C_ADDI: case MN_C_LI: case MN_C_LUI: case MN_C_ADDI16SP: case MN_C_ANDI: case MN_C_SRLI: case MN_C_SRAI: case MN_C_SLLI: case MN_C_LWSP:
+        case MN_C_ADDIW: case MN_C_LDSP: case MN_C_FLWSP: case MN_C_FLDSP:
+            return STAT_CI;
+        case MN_C_JAL: case MN_C_J: return STAT_CJ;
+        case MN_C_BEQZ: case MN_C_BNEZ: return STAT_CB;
+        case MN_C_EBREAK: case MN_C_JR: case MN_C_JALR: case MN_C_MV: case MN_C_ADD: return STAT_CR;
+        case MN_C_SWSP: case MN_C_SDSP: case MN_C_FSWSP: case MN_C_FSDSP: return STAT_CSS;
+        default: return FORMAT_UNKNOWN;
+    }
+}
+
+// What --stats reports, summed over the files of a batch (so with several batch threads the seconds add up to more
+// than the wall time). Threads count into their own copy, which takes whole cache lines, and add() them up at the end.
+struct alignas(64) Disasm_Stats {
+    double seconds[STAGE_COUNT] = {};
+    uint64_t formats[STAT_FORMAT_COUNT] = {};
+    uint64_t files = 0, compressed = 0, full = 0, unknown = 0, bytes_written = 0;
+
+    // Counts the instruction at data, decoded as `mnemonic` (MN_UNKNOWN for an encoding that is not valid or of an
+    // extension the file does not have, which is still counted under the format of its opcode).
+    template<unsigned xlen>
+    void count(const uint8_t *data, uint8_t mnemonic) {
+        uint16_t part1 = read_parcel(data);
+        if ((part1 & 0b11) != 0b11) {
+            compressed++;
+            formats[rvc_stat_format(mnemonic)]++;
+        } else {
+            full++;
+            formats[(xlen == 64 ? formats64 : formats32)[part1 & 0x7f]]++;
+        }
+        unknown += (mnemonic == MN_UNKNOWN);
+    }
+
+    void add(const Disasm_Stats &other) {
+        for (size_t i = 0; i < STAGE_COUNT; i++) seconds[i] += other.seconds[i];
+        for (size_t i = 0; i < STAT_FORMAT_COUNT; i++) formats[i] += other.formats[i];
+        files += other.files;
+        compressed += other.compressed;
+        full += other.full;
+        unknown += other.unknown;
+        bytes_written += other.bytes_written;
+    }
+};
+
+// Charges the time between consecutive lap() calls to stages of `stats`; does nothing if stats is nullptr.
+class Stage_Clock {
+private:
+    Disasm_Stats *stats;
+    std::chrono::steady_clock::time_point last;
+
+public:
+    explicit Stage_Clock(Disasm_Stats *stats) : stats(stats) {
+        if (stats_enabled && stats != nullptr) last = std::chrono::steady_clock::now();
+    }
+
+    // Charges the time since the last lap to `stage`, less `excluded` seconds spent in another stage meanwhile.
+    void lap(Stat_Stage stage, double excluded = 0) {
+        if (!stats_enabled || stats == nullptr) return;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        stats->seconds[stage] += std::chrono::duration<double>(now - last).count() - excluded;
+        last = now;
+    }
+};
+
+// Writes `stats` as a summary table, or with `json` as one JSON object on a line.
+inline void print_stats(const Disasm_Stats &stats, bool json, Output_Buffer &output) {
+    double total = 0;
+    for (double seconds : stats.seconds) total += seconds;
+    uint64_t insns = stats.compressed + stats.full;
+    if (json) {
+        output.print("{\"files\":%llu,\"seconds\":{", (unsigned long long)stats.files);
+        for (size_t i = 0; i < STAGE_COUNT; i++) output.print("\"%s\":%.6f,", stage_names[i].data(), stats.seconds[i]);
+        output.print("\"total\":%.6f},\"instructions\":%llu,\"compressed\":%llu,\"full\":%llu,\"unknown\":%llu,\"bytes_written\":%llu,\"formats\":{",
+                     total, (unsigned long long)insns, (unsigned long long)stats.compressed, (unsigned long long)stats.full, (unsigned long long)stats.unknown,
+                     (unsigned long long)stats.bytes_written);
+        for (size_t i = 0; i < STAT_FORMAT_COUNT; i++) output.print("%s\"%s\":%llu", i == 0 ? "" : ",", stat_format_names[i].data(), (unsigned long long)stats.formats[i]);
+        output.write("}}\n");
+        return;
+    }
+    auto percent = [](double part, double whole) {
+        return (whole > 0 ? 100 * part / whole : 0.0);
+    };
+    output.print("files: %llu\n", (unsigned long long)stats.files);
+    for (size_t i = 0; i < STAGE_COUNT; i++) output.print("%-8s %10.3f ms %5.1f%%\n", stage_names[i].data(), stats.seconds[i] * 1e3, percent(stats.seconds[i], total));
+    output.print("%-8s %10.3f ms\n", "total", total * 1e3);
+    output.print("instructions: %llu, 16-bit %llu (%.1f%%), 32-bit %llu (%.1f%%), unknown %llu (%.2f%%)\n", (unsigned long long)insns,
+                 (unsigned long long)stats.compressed, percent(stats.compressed, insns), (unsigned long long)stats.full, percent(stats.full, insns),
+                 (unsigned long long)stats.unknown, percent(stats.unknown, insns));
+    output.print("bytes written: %llu\n", (unsigned long long)stats.bytes_written);
+    for (size_t i = 0; i < STAT_FORMAT_COUNT; i++) {
+        if (stats.formats[i] != 0) output.print("  %-14s %12llu %5.1f%%\n", stat_format_names[i].data(), (unsigned long long)stats.formats[i], percent(stats.formats[i], insns));
+    }
+}
+
+#endif //LAB3_STATS_HPP
@@ -0,0 +1,120 @@
+#ifndef LAB3_SYMBOLS_HPP
+#define LAB3_SYMBOLS_HPP
+
+#include "elf.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string_view>
+#include <vector>
+
+// Named symbols as address intervals [st_value, st_value + st_size), for "which function is this address in" and
+// "where is function X" queries. Section and file symbols are left out; a symbol with st_size == 0 extends to the
+// next named symbol (or to `limit`). Names are offsets into .strtab, so the index lives as long as its image, and
+// like Label_Index its arrays are either owned (after build()) or borrowed from an index file (after attach()).
+// Address is the address type of the ELF class; Symbol_Index is the ELF32 one.
+template<typename Address>
+class Basic_Symbol_Index {
+public:
+    struct Interval {
+        Address begin;
+        Address end;
+        uint32_t symbol;
+        uint32_t name_offset;   // into .strtab
+        uint32_t name_length;
+    };
+
+    struct Tables {
+        const Interval *intervals;   // sorted by begin
+        const Address *max_end;      // max_end[i] = max(intervals[0..i].end)
+        const uint32_t *by_name;     // indexes into intervals, sorted by name
+        size_t count;
+    };
+
+private:
+    std::vector<Interval> intervals;
+    std::vector<Address> max_end;
+    std::vector<uint32_t> by_name;
+    Tables active{};
+    const char *strtab = nullptr;
+
+public:
+    template<typename Symbol>
+    void build(const Symbol *symbols, size_t symbols_count, const uint8_t *strtab, size_t strtab_size, Address limit) {
+        this->strtab = reinterpret_cast<const char *>(strtab);
+        intervals.clear();
+        for (size_t i = 0; i < symbols_count; i++) {
+            const Symbol &symbol = symbols[i];
+            if (symbol.st_name == 0 || symbol.st_name >= strtab_size || (symbol.st_info & 0xf) == 3 || (symbol.st_info & 0xf) == 4) continue;
+            size_t name_end = symbol.st_name;
+            while (name_end < strtab_size && strtab[name_end] != 0) name_end++;
+            if (name_end == symbol.st_name) continue;
+            Address end_address = symbol.st_value + symbol.st_size;
+            intervals.push_back({symbol.st_value, end_address < symbol.st_value ? std::numeric_limits<Address>::max() : end_address, (uint32_t)i, symbol.st_name, (uint32_t)(name_end - symbol.st_name)});
+        }
+        std::stable_sort(intervals.begin(), intervals.end(), [](const Interval &a, const Interval &b) {
+            return a.begin < b.begin;
+        });
+        for (size_t i = 0, next = 0; i < intervals.size(); i++) {
+            if (intervals[i].end > intervals[i].begin) continue;
+            while (next < intervals.size() && intervals[next].begin <= intervals[i].begin) next++;
+            intervals[i].end = (next < intervals.size() ? intervals[next].begin : std::max(limit, intervals[i].begin));
+        }
+
+        max_end.resize(intervals.size());
+        for (size_t i = 0; i < intervals.size(); i++) max_end[i] = std::max<Address>(intervals[i].end, i > 0 ? max_end[i - 1] : 0);
+        by_name.resize(intervals.size());
+        for (size_t i = 0; i < intervals.size(); i++) by_name[i] = i;
+        std::stable_sort(by_name.begin(), by_name.end(), [this](uint32_t a, uint32_t b) {
+            return name(intervals[a]) < name(intervals[b]);
+        });
+        active = {intervals.data(), max_end.data(), by_name.data(), intervals.size()};
+    }
+
+    // Uses arrays owned by someone else (an mmap'ed index file); names are still read from `strtab`.
+    void attach(const Tables &tables, const uint8_t *strtab) {
+        intervals.clear();
+        max_end.clear();
+        by_name.clear();
+        active = tables;
+        this->strtab = reinterpret_cast<const char *>(strtab);
+    }
+
+    const Tables &tables() const {
+        return active;
+    }
+
+    std::string_view name(const Interval &interval) const {
+        return std::string_view(strtab + interval.name_offset, interval.name_length);
+    }
+
+    // Interval of the symbol called `name` (the lowest one if there are several), or nullptr.
+    const Interval *find(std::string_view name) const {
+        const uint32_t *end = active.by_name + active.count;
+        const uint32_t *it = std::lower_bound(active.by_name, end, name, [this](uint32_t idx, std::string_view value) {
+            return this->name(active.intervals[idx]) < value;
+        });
+        if (it == end || this->name(active.intervals[*it]) != name) return nullptr;
+        return &active.intervals[*it];
+    }
+
+    // The innermost interval containing `address` (the one that starts last), or nullptr.
+    const Interval *containing(Address address) const {
+        size_t i = std::upper_bound(active.intervals, active.intervals + active.count, address, [](Address value, const Interval &interval) {
+            return value < interval.begin;
+        }) - active.intervals;
+        while (i > 0 && active.max_end[i - 1] > address) {
+            i--;
+            if (active.intervals[i].end > address) return &active.intervals[i];
+        }
+        return nullptr;
+    }
+
+    size_t size() const {
+        return active.count;
+    }
+};
+
+using Symbol_Index = Basic_Symbol_Index<uint32_t>;
+
+#endif //LAB3_SYMBOLS_HPP
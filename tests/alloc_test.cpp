@@ -0,0 +1,104 @@
+#include "../bench/synthetic_elf.hpp"
+#include "../decode.hpp"
+#include "../elf.hpp"
+#include "../format.hpp"
+#include "../labels.hpp"
+
+#include <atomic>
+#include <iostream>
+#include <new>
+
+// Every heap allocation in the process is counted, so the decoding and formatting loops can check that they do none.
+std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size) {
+    allocations++;
+    if (void *ptr = malloc(size == 0 ? 1 : size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept {
+    free(ptr);
+}
+
+// The last section called `name` of an ELF file of class ELF.
+template<typename ELF>
+typename ELF::Section_Header find_elf_section(const ELF_Image &image, std::string_view name) {
+    const typename ELF::File_Header &file_header = *image.view<typename ELF::File_Header>(0);
+    const typename ELF::Section_Header &shstrtab_header = *image.view<typename ELF::Section_Header>(file_header.e_shoff + (uint64_t)file_header.e_shstrndx * file_header.e_shentsize);
+    const char *shstrtab = image.view<char>(shstrtab_header.sh_offset, shstrtab_header.sh_size);
+    typename ELF::Section_Header result{};
+    for (size_t i = 0; i < file_header.e_shnum; i++) {
+        const typename ELF::Section_Header &section_header = *image.view<typename ELF::Section_Header>(file_header.e_shoff + i * file_header.e_shentsize);
+        if (section_header.sh_name < shstrtab_header.sh_size && name == shstrtab + section_header.sh_name) result = section_header;
+    }
+    return result;
+}
+
+// Decodes and prints all of .text of `file` as text and as JSON Lines, writing to /dev/null, and returns the number
+// of operator new calls made meanwhile. The label index and the output buffer are set up before counting starts.
+template<typename ELF>
+size_t count_allocations(const std::vector<uint8_t> &file) {
+    using Address = typename ELF::Address;
+    ELF_Image image;
+    image.assign(file.data(), file.size());
+    typename ELF::Section_Header text_header = find_elf_section<ELF>(image, ".text"), symtab_header = find_elf_section<ELF>(image, ".symtab"),
+                                 strtab_header = find_elf_section<ELF>(image, ".strtab");
+    const uint8_t *text = image.view<uint8_t>(text_header.sh_offset, text_header.sh_size);
+    size_t text_size = text_header.sh_size, symbols_count = symtab_header.sh_size / sizeof(typename ELF::Symbol);
+    const typename ELF::Symbol *symbols = image.view<typename ELF::Symbol>(symtab_header.sh_offset, symbols_count);
+    const uint8_t *strtab = image.view<uint8_t>(strtab_header.sh_offset, strtab_header.sh_size);
+    Address address = text_header.sh_addr;
+
+    std::vector<Address> targets;
+    for (size_t cur = 0; cur < text_size;) {
+        check_insn(text, cur, text_size);
+        Basic_Insn<Address> insn = decode_insn<ELF>(text + cur, address + cur);
+        if (insn.has_target) targets.push_back(insn.target);
+        cur += insn.length;
+    }
+    Basic_Label_Index<Address> labels;
+    labels.build(symbols, symbols_count, strtab, strtab_header.sh_size, targets, address, text_size);
+    FILE *null_file = fopen("/dev/null", "w");
+    if (null_file == nullptr) throw FileNotFoundException("Unable to open /dev/null!");
+    Output_Buffer output(null_file);
+
+    size_t before = allocations;
+    for (size_t cur = 0; cur < text_size;) {
+        check_insn(text, cur, text_size);
+        Basic_Insn<Address> insn = decode_insn<ELF>(text + cur, address + cur);
+        print_insn(insn, labels.find(insn.address), (insn.has_target ? labels.find(insn.target) : std::string_view()), output);
+        cur += insn.length;
+    }
+    for (size_t cur = 0; cur < text_size;) {
+        check_insn(text, cur, text_size);
+        Basic_Insn<Address> insn = decode_insn<ELF>(text + cur, address + cur);
+        print_insn_json(insn, labels.find(insn.address), (insn.has_target ? labels.find(insn.target) : std::string_view()), output);
+        cur += insn.length;
+    }
+    output.flush();
+    size_t counted = allocations - before;
+    output.set_file(nullptr);
+    fclose(null_file);
+    return counted;
+}
+
+// Fails if decoding and formatting a large synthetic .text, RV32 and RV64 with a share of extension instructions,
+// allocates any memory.
+int main(int argc, char *argv[]) {
+    size_t size = (argc > 1 ? std::stoull(argv[1]) : 4 << 20);
+    try {
+        size_t rv32 = count_allocations<ELF32>(Synthetic_ELF(1, 50, 10).generate(size));
+        size_t rv64 = count_allocations<ELF64>(Synthetic_ELF(2, 50, 10).generate64(size));
+        printf("heap allocations while decoding and formatting %zu bytes of .text: RV32 %zu, RV64 %zu\n", size, rv32, rv64);
+        if (rv32 != 0 || rv64 != 0) return 2;
+    } catch (std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,10 @@
+# Runs `LAB3 ARGS INPUT OUTPUT` and fails unless it exits with 0 and OUTPUT is the same as EXPECTED:
+#   cmake -DLAB3=... -DINPUT=... -DEXPECTED=... -DOUTPUT=... [-DARGS=...] -P compare_listing.cmake
+execute_process(COMMAND ${LAB3} ${ARGS} ${INPUT} ${OUTPUT} RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+    message(FATAL_ERROR "lab3 ${ARGS} ${INPUT} exited with ${result}")
+endif()
+execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${OUTPUT} ${EXPECTED} RESULT_VARIABLE differs)
+if(differs)
+    message(FATAL_ERROR "${OUTPUT} differs from ${EXPECTED}")
+endif()
@@ -0,0 +1,8 @@
+#!/bin/sh
+# Rebuilds the ELF fixtures from their sources with llvm-mc; the expected listings are checked by hand against
+# llvm-objdump before they are updated. Run from this directory.
+set -e
+attrs=+m,+a,+f,+d,+c,+zba,+zbb,+zbs
+for name in rv32 rv32_imac; do llvm-mc -triple=riscv32 -mattr=$attrs -filetype=obj $name.s -o $name.elf; done
+llvm-mc -triple=riscv32 -mattr=$attrs -target-abi=ilp32d -filetype=obj rv32_float_abi.s -o rv32_float_abi.elf
+for name in rv64 rv64_dzba rv64_gc; do llvm-mc -triple=riscv64 -mattr=$attrs -filetype=obj $name.s -o $name.elf; done
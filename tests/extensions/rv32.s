@@ -0,0 +1,123 @@
+# The RV32 instructions of every extension; t0, t1, ft0, ... are used where a compressible register would let the
+# assembler pick the RVC form.
+.option norelax
+.text
+.globl _start
+_start:
+    # A
+    lr.w t0, (t1)
+    sc.w.aq t0, t2, (t1)
+    amoswap.w t0, t2, (t1)
+    amoadd.w.rl t0, t2, (t1)
+    amoxor.w.aqrl t0, t2, (t1)
+    amoand.w t0, t2, (t1)
+    amoor.w t0, t2, (t1)
+    amomin.w t0, t2, (t1)
+    amomax.w t0, t2, (t1)
+    amominu.w t0, t2, (t1)
+    amomaxu.w t0, t2, (t1)
+    # F
+    flw ft0, -4(t0)
+    fsw ft1, 8(t0)
+    fadd.s ft0, ft1, ft2
+    fsub.s ft0, ft1, ft2, rtz
+    fmul.s ft0, ft1, ft2
+    fdiv.s ft0, ft1, ft2
+    fsqrt.s ft0, ft1
+    fsgnj.s ft0, ft1, ft2
+    fsgnjn.s ft0, ft1, ft2
+    fsgnjx.s ft0, ft1, ft2
+    fmin.s ft0, ft1, ft2
+    fmax.s ft0, ft1, ft2
+    fcvt.w.s t0, ft1, rtz
+    fcvt.wu.s t0, ft1
+    fcvt.s.w ft0, t1
+    fcvt.s.wu ft0, t1
+    fmv.x.w t0, ft1
+    fmv.w.x ft0, t1
+    feq.s t0, ft1, ft2
+    flt.s t0, ft1, ft2
+    fle.s t0, ft1, ft2
+    fclass.s t0, ft1
+    fmadd.s ft0, ft1, ft2, ft3
+    fmsub.s ft0, ft1, ft2, ft3
+    fnmsub.s ft0, ft1, ft2, ft3
+    fnmadd.s ft0, ft1, ft2, ft3, rne
+    # D
+    fld ft0, 16(t0)
+    fsd ft1, -16(t0)
+    fadd.d ft0, ft1, ft2
+    fmul.d ft0, ft1, ft2
+    fsqrt.d ft0, ft1
+    fsgnj.d ft0, ft1, ft2
+    fmin.d ft0, ft1, ft2
+    fcvt.s.d ft0, ft1
+    fcvt.d.s ft0, ft1
+    fcvt.w.d t0, ft1
+    fcvt.d.wu ft0, t1
+    feq.d t0, ft1, ft2
+    fclass.d t0, ft1
+    fmadd.d ft0, ft1, ft2, ft3
+    # RVC floating-point loads and stores
+    c.flw fa0, 4(a1)
+    c.fsw fa0, 8(a1)
+    c.flwsp fa1, 12(sp)
+    c.fswsp fa1, 16(sp)
+    c.fld fa0, 8(a1)
+    c.fsd fa0, 16(a1)
+    c.fldsp fa1, 24(sp)
+    c.fsdsp fa1, 32(sp)
+    # Zicsr
+    csrrw t0, mstatus, t1
+    csrrs t0, fcsr, zero
+    csrrc t0, mie, t1
+    csrrwi t0, mtvec, 4
+    csrrsi t0, sstatus, 1
+    csrrci t0, mscratch, 31
+    csrrs t0, cycleh, zero
+    csrrs t0, 0x7c0, zero
+    # Zifencei and the base system instructions
+    fence.i
+    fence
+    fence rw, w
+    fence.tso
+    ecall
+    ebreak
+    mret
+    sret
+    wfi
+    # Zba
+    sh1add t0, t1, t2
+    sh2add t0, t1, t2
+    sh3add t0, t1, t2
+    # Zbb
+    andn t0, t1, t2
+    orn t0, t1, t2
+    xnor t0, t1, t2
+    clz t0, t1
+    ctz t0, t1
+    cpop t0, t1
+    max t0, t1, t2
+    maxu t0, t1, t2
+    min t0, t1, t2
+    minu t0, t1, t2
+    sext.b t0, t1
+    sext.h t0, t1
+    zext.h t0, t1
+    rol t0, t1, t2
+    ror t0, t1, t2
+    rori t0, t1, 7
+    orc.b t0, t1
+    rev8 t0, t1
+    # Zbs
+    bclr t0, t1, t2
+    bclri t0, t1, 3
+    bext t0, t1, t2
+    bexti t0, t1, 31
+    binv t0, t1, t2
+    binvi t0, t1, 5
+    bset t0, t1, t2
+    bseti t0, t1, 0
+1:
+    beq t0, t1, 1b
+    jalr zero, 0(ra)
@@ -0,0 +1,4 @@
+# Version 2.1 of I has neither Zicsr nor Zifencei; F and D come from the double-float ABI in e_flags.
+.include "rv32.s"
+.include "arch.inc"
+riscv_arch "rv32i2p1_m2p0_c2p0", 18
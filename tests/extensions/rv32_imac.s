@@ -0,0 +1,4 @@
+# Version 2.0 of I still includes Zicsr and Zifencei; F, D and B are not decoded.
+.include "rv32.s"
+.include "arch.inc"
+riscv_arch "rv32i2p0_m2p0_a2p0_c2p0", 23
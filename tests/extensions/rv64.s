@@ -0,0 +1,63 @@
+# The RV64 instructions of every extension, besides those that RV64 shares with RV32.
+.option norelax
+.text
+.globl _start
+_start:
+    # A
+    lr.d t0, (t1)
+    sc.d.rl t0, t2, (t1)
+    amoswap.d.aq t0, t2, (t1)
+    amoadd.d t0, t2, (t1)
+    amomaxu.d t0, t2, (t1)
+    amoadd.w t0, t2, (t1)
+    # F and D
+    flw ft0, -4(t0)
+    fld ft1, 8(t0)
+    fsd ft1, 16(t0)
+    fadd.d ft0, ft1, ft2
+    fcvt.l.s t0, ft1
+    fcvt.lu.s t0, ft1, rtz
+    fcvt.s.l ft0, t1
+    fcvt.l.d t0, ft1
+    fcvt.d.lu ft0, t1
+    fmv.x.d t0, ft1
+    fmv.d.x ft0, t1
+    fmv.x.w t0, ft1
+    fmadd.s ft0, ft1, ft2, ft3
+    # RVC: c.fld and c.fsd as on RV32, c.ld and c.sd on the encodings of c.flw and c.fsw
+    c.fld fa0, 8(a1)
+    c.fsdsp fa1, 32(sp)
+    c.ld a0, 8(a1)
+    c.sdsp a1, 16(sp)
+    # Zicsr and Zifencei
+    csrrw t0, mstatus, t1
+    csrrs t0, cycle, zero
+    csrrs t0, 0xc80, zero
+    fence.i
+    # Zba
+    add.uw t0, t1, t2
+    sh1add t0, t1, t2
+    sh2add.uw t0, t1, t2
+    sh3add.uw t0, t1, t2
+    slli.uw t0, t1, 40
+    zext.w t0, t1
+    # Zbb
+    clz t0, t1
+    clzw t0, t1
+    ctzw t0, t1
+    cpopw t0, t1
+    rolw t0, t1, t2
+    rorw t0, t1, t2
+    rori t0, t1, 40
+    roriw t0, t1, 7
+    rev8 t0, t1
+    zext.h t0, t1
+    sext.b t0, t1
+    # Zbs
+    bclri t0, t1, 63
+    bexti t0, t1, 32
+    bset t0, t1, t2
+1:
+    bne t0, t1, 1b
+    ld t0, 8(t1)
+    jalr zero, 0(ra)
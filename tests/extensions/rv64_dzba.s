@@ -0,0 +1,4 @@
+# D brings F along; Zicsr and Zba are named, A, Zifencei, Zbb and Zbs are not.
+.include "rv64.s"
+.include "arch.inc"
+riscv_arch "rv64i2p1_m2p0_d2p2_zicsr2p0_zba1p0_c2p0", 39
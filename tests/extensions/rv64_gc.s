@@ -0,0 +1,4 @@
+# The expansion of rv64gc: everything but B.
+.include "rv64.s"
+.include "arch.inc"
+riscv_arch "rv64i2p1_m2p0_a2p1_f2p2_d2p2_c2p0_zicsr2p0_zifencei2p0", 54
@@ -0,0 +1,75 @@
+# Checks that --index changes nothing but the speed, on synthetic files of GEN_ELF with SECTIONS code sections and
+# XLEN-bit code (ELF32 or ELF64): the listing and a --range RANGE query with the index built, reused and rebuilt are
+# the same as without it, and the query lines are the ones of the listing. The index is
+# rebuilt after the ELF file gets other contents of the same size or another size, reused after the file is touched
+# without a change, and rebuilt when it is garbage or the index of another file. --index with --format columnar is
+# rejected.
+#   cmake -DLAB3=... -DGEN_ELF=... -DWORK_DIR=... -DSECTIONS=N -DXLEN=32|64 -DRANGE=BEGIN:END -P index_check.cmake
+set(elf ${WORK_DIR}/input.elf)
+set(index ${elf}.rvidx)
+file(MAKE_DIRECTORY ${WORK_DIR})
+file(REMOVE ${index})
+
+function(run)
+    execute_process(COMMAND ${LAB3} ${ARGN} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "lab3 ${ARGN} exited with ${result}")
+    endif()
+endfunction()
+
+function(generate size seed path)
+    execute_process(COMMAND ${GEN_ELF} ${size} ${seed} ${path} 50 ${XLEN} ${SECTIONS} OUTPUT_QUIET RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "gen_elf ${size} ${seed} ${path} exited with ${result}")
+    endif()
+endfunction()
+
+function(compare what name)
+    execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${WORK_DIR}/${name}.txt ${WORK_DIR}/${name}_index.txt RESULT_VARIABLE differs)
+    if(differs)
+        message(FATAL_ERROR "${what}: ${name} with --index differs from ${name} without it")
+    endif()
+endfunction()
+
+# Compares the outputs with --index to those without it for the current ELF file and index; the listing goes first,
+# so it is the one that builds or checks the index.
+function(check what)
+    run(--index ${elf} ${WORK_DIR}/listing_index.txt)
+    run(${elf} ${WORK_DIR}/listing.txt)
+    compare("${what}" listing)
+    run(--index --range ${RANGE} ${elf} ${WORK_DIR}/range_index.txt)
+    run(--range ${RANGE} ${elf} ${WORK_DIR}/range.txt)
+    compare("${what}" range)
+    file(READ ${WORK_DIR}/listing.txt listing)
+    file(READ ${WORK_DIR}/range.txt range)
+    string(FIND "${listing}" "${range}" position)
+    if(range STREQUAL "" OR position EQUAL -1)
+        message(FATAL_ERROR "${what}: the --range lines are not the ones of the listing")
+    endif()
+    if(NOT EXISTS ${index})
+        message(FATAL_ERROR "${what}: no index was written")
+    endif()
+endfunction()
+
+generate(20000 1 ${elf})
+# The columnar format does not go through the index, so asking for both is an error that writes no index.
+execute_process(COMMAND ${LAB3} --index --format columnar ${elf} ${WORK_DIR}/columnar.col RESULT_VARIABLE result ERROR_QUIET)
+if(NOT result EQUAL 1 OR EXISTS ${index})
+    message(FATAL_ERROR "--index --format columnar: exited with ${result} instead of being rejected")
+endif()
+check("new index")
+check("reused index")
+generate(20000 2 ${elf})
+check("other contents of the same size")
+generate(24000 3 ${elf})
+check("another size")
+file(TOUCH ${elf})
+check("touched without a change")
+file(WRITE ${index} "not an index")
+check("garbage index")
+file(WRITE ${index} "")
+check("empty index")
+generate(24000 4 ${WORK_DIR}/other.elf)
+run(--index ${WORK_DIR}/other.elf ${WORK_DIR}/other.txt)
+file(COPY_FILE ${WORK_DIR}/other.elf.rvidx ${index})
+check("index of another file")